@@ -0,0 +1,481 @@
+// ==================================================
+// file: bench.cpp
+// project: Tim Site Generator
+// author: Paulina Kalicka
+// ==================================================
+
+#include "tim.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#define BENCH_SITE_NAME ("bench_site")
+#define BENCH_OPTIONS   ("--pages N / --depth N / --fanout N / --content-size BYTES / --placeholders PER_KB / --assets N / --runs N / --seed N / --dir DIR / --keep / -j N")
+
+/* shape of a synthetic site and how it is measured */
+struct BenchConfig
+{
+	unsigned    pages        = 2000; // HTML pages in _feed, the first one of every directory is its index.html
+	unsigned    depth        = 3;    // how deep directories are nested
+	unsigned    fanout       = 4;    // directories in every directory that is not the deepest one
+	unsigned    content_size = 4096; // bytes of text in every page
+	unsigned    placeholders = 8;    // '~' placeholders in every 1024 bytes of text
+	unsigned    assets       = 200;  // files that are only copied
+	unsigned    runs         = 5;    // how many times every benchmark is measured, the median is reported
+	unsigned    seed         = 1;    // the same seed always gives the same site
+	std::string dir;                 // where the site is generated, a temporary folder by default
+	bool        keep = false;        // do not delete the site at the end
+};
+
+/* result of a single benchmark */
+struct BenchResult
+{
+	std::string name;
+	double      median_ms = 0;
+	double      min_ms    = 0;
+	uint64_t    items     = 0; // pages, files or calls done in one run
+	const char* unit      = "";
+	uint64_t    bytes     = 0; // bytes read or written in one run
+};
+
+/* next number of a simple generator, the same sequence on every platform */
+static uint64_t NextRandom(uint64_t& state)
+{
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z          = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+/* count files with one of given extensions in a folder and sum their sizes */
+static uint64_t GetFolderBytes(std::string dir, std::vector<std::string> extensions, uint64_t& files)
+{
+	uint64_t bytes = 0;
+	files          = 0;
+	for(const auto& entry : std::filesystem::recursive_directory_iterator(dir, error_code))
+	{
+		if(entry.is_regular_file(error_code) && (std::find(extensions.begin(), extensions.end(), entry.path().extension().string()) != extensions.end()))
+		{
+			bytes += entry.file_size(error_code);
+			++files;
+		}
+	}
+	return bytes;
+}
+
+/* write text of a page with placeholders spread over it */
+static void WriteBenchContent(const BenchConfig& config, uint64_t& state, std::string& output)
+{
+	static const char* const words[]        = {"lorem", "ipsum", "dolor", "sit", "amet", "site", "page", "static", "tim", "generator", "content", "feed"};
+	static const char* const placeholders[] = {"~:author~", "~:tagline~", "~+heading~", "~+summary~", "~_name~", "~_url~"};
+
+	std::size_t begin      = output.size();
+	uint64_t    every      = config.placeholders ? (1024 / config.placeholders) : (0);
+	uint64_t    next_token = every;
+	std::size_t line_size  = 0;
+	output += "<p>";
+	while(output.size() - begin < config.content_size)
+	{
+		if(every && (output.size() - begin >= next_token))
+		{
+			output += placeholders[NextRandom(state) % (sizeof(placeholders) / sizeof(*placeholders))];
+			next_token += every;
+		}
+		else
+			output += words[NextRandom(state) % (sizeof(words) / sizeof(*words))];
+
+		output += ' ';
+		if(++line_size == 12)
+		{
+			output += "</p>\n<p>";
+			line_size = 0;
+		}
+	}
+	output += "</p>\n";
+}
+
+/* create a synthetic site made only from the given config */
+static bool GenerateBenchSite(Site* site, const BenchConfig& config)
+{
+	std::filesystem::remove_all(site->directory, error_code);
+	if(!std::filesystem::create_directories(site->feed_dir, error_code))
+	{
+		log_failure(site->feed_dir << " directory was NOT created");
+		log_error_code;
+		return false;
+	}
+
+	bool ok = WriteFile(site->base_file_dir, "<!DOCTYPE html>\n<html>\n<head>\n    <title>~_title~ - ~_name~</title>\n"
+	                                         "    <link href=\"~_url~/style.css\" rel=\"stylesheet\">\n</head>\n<body>\n"
+	                                         "    <header>~_feed_links~</header>\n    <nav>~_prev_links~ ~_next_links~</nav>\n"
+	                                         "    ~_if.page.site_index~<h1>~:author~</h1>~_endif~\n"
+	                                         "    ~_ifnot.page.site_index~<h1>~+heading~</h1>~_endif~\n"
+	                                         "    <main>~_content~</main>\n    <aside>~_page_links~</aside>\n"
+	                                         "    <footer>~:tagline~ ~_this_url~</footer>\n</body>\n</html>\n");
+
+	std::string data = "url:https://bench.example.org\nauthor:Tim Bench\ntagline:made by a synthetic benchmark\n";
+	for(unsigned i = 0; i < 32; ++i)
+		data += "key_" + std::to_string(i) + ":value of key number " + std::to_string(i) + "\n";
+	ok = ok && WriteFile(site->data_file_dir, data);
+	ok = ok && WriteFile(site->config_file_dir, "index_page:true\nto_pack:.html,.css,.js\n");
+
+	// directories in breadth-first order so the first ones are the least nested
+	std::vector<std::string> dirs = {""};
+	for(std::size_t i = 0, level_end = 1, level = 0; (i < level_end) && (level < config.depth); ++i)
+	{
+		for(unsigned n = 0; n < config.fanout; ++n)
+		{
+			std::string name = "dir_" + std::to_string(n);
+			dirs.push_back(dirs[i].size() ? (dirs[i] + PATH_SEPARATOR + name) : (name));
+			std::filesystem::create_directories(site->feed_dir + PATH_SEPARATOR + dirs.back(), error_code);
+		}
+		if(i + 1 == level_end)
+		{
+			level_end = dirs.size();
+			++level;
+		}
+	}
+
+	uint64_t    state = config.seed;
+	std::string page;
+	for(unsigned i = 0; ok && (i < config.pages); ++i)
+	{
+		const std::string& dir  = dirs[i % dirs.size()];
+		std::string        name = (i < dirs.size()) ? ("index.html") : ("page_" + std::to_string(i) + ".html");
+
+		page = "heading:Heading of page " + std::to_string(i) + "\nsummary:summary of page " + std::to_string(i) + "\n;:\n";
+		WriteBenchContent(config, state, page);
+		ok = WriteFile(site->feed_dir + PATH_SEPARATOR + (dir.size() ? (dir + PATH_SEPARATOR) : ("")) + name, page);
+	}
+
+	// the first asset is the style every page uses
+	static const char* const extensions[] = {".css", ".js", ".png"};
+	std::string              asset;
+	for(unsigned i = 0; ok && (i < config.assets); ++i)
+	{
+		const std::string& dir       = (i) ? (dirs[NextRandom(state) % dirs.size()]) : (dirs[0]);
+		const char*        extension = extensions[i % 3];
+		std::string        name      = (i) ? ("asset_" + std::to_string(i) + extension) : ("style.css");
+
+		asset.clear();
+		std::size_t size = 1024 + NextRandom(state) % (16 * 1024);
+		while(asset.size() < size)
+			asset += (i % 3 == 2) ? (std::string(1, (char)NextRandom(state))) : ("body  {\n    margin : 0 ;\n    color : #123456 ;\n}\n\n");
+		ok = WriteFile(site->feed_dir + PATH_SEPARATOR + (dir.size() ? (dir + PATH_SEPARATOR) : ("")) + name, asset);
+	}
+
+	if(!ok)
+		log_failure("Synthetic site was NOT generated");
+	return ok;
+}
+
+/* run a task the given number of times after a warm up run, setup is not measured,
+ return false if any run of the task failed */
+static bool Measure(BenchResult& result, unsigned runs, const std::function<bool()>& setup, const std::function<bool()>& task)
+{
+	std::vector<double> times;
+	for(unsigned run = 0; run <= runs; ++run)
+	{
+		if(setup && !setup())
+			return false;
+		auto begin = std::chrono::steady_clock::now();
+		bool ok    = task();
+		auto end   = std::chrono::steady_clock::now();
+		if(!ok)
+			return false;
+		if(run)
+			times.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+	}
+	std::sort(times.begin(), times.end());
+	result.median_ms = times[times.size() / 2];
+	result.min_ms    = times[0];
+	return true;
+}
+
+/* print results as a table, the same columns for every benchmark */
+static void PrintResults(const std::deque<BenchResult>& results)
+{
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-22s %12s %12s %10s %-6s %14s %10s", "benchmark", "median ms", "min ms", "items", "", "items/s", "MB/s");
+	std::cout << line << "\n";
+	for(const BenchResult& result : results)
+	{
+		double seconds = result.median_ms / 1000.0;
+		double per_sec = (seconds > 0) ? (result.items / seconds) : (0);
+		double mb_sec  = (seconds > 0) ? (result.bytes / seconds / (1024.0 * 1024.0)) : (0);
+		std::snprintf(line, sizeof(line), "%-22s %12.3f %12.3f %10" PRIu64 " %-6s %14.1f %10.2f", result.name.c_str(), result.median_ms, result.min_ms, result.items, result.unit, per_sec, mb_sec);
+		std::cout << line << "\n";
+	}
+}
+
+/* read options of benchmarks from the command line */
+static bool GetBenchArguments(int argv, char** argc, BenchConfig& config)
+{
+	for(int i = 1; i < argv; ++i)
+	{
+		std::string arg = argc[i];
+		if(arg == "--keep")
+		{
+			config.keep = true;
+			continue;
+		}
+		if(++i >= argv)
+			return false;
+		std::string value = argc[i];
+
+		if(arg == "--dir")
+			config.dir = value;
+		else if((arg == "-j") || (arg == "--jobs"))
+		{
+			if((value != "auto") && (!ParseUnsigned(value, options.jobs) || !options.jobs))
+				return false;
+		}
+		else
+		{
+			unsigned* field = (arg == "--pages")          ? (&config.pages)
+			                  : (arg == "--depth")        ? (&config.depth)
+			                  : (arg == "--fanout")       ? (&config.fanout)
+			                  : (arg == "--content-size") ? (&config.content_size)
+			                  : (arg == "--placeholders") ? (&config.placeholders)
+			                  : (arg == "--assets")       ? (&config.assets)
+			                  : (arg == "--runs")         ? (&config.runs)
+			                  : (arg == "--seed")         ? (&config.seed)
+			                                              : (nullptr);
+			if(!field || !ParseUnsigned(value, *field))
+				return false;
+		}
+	}
+	return config.pages && config.runs;
+}
+
+int main(int argv, char** argc)
+{
+	BenchConfig config;
+	if(!GetBenchArguments(argv, argc, config))
+	{
+		log_failure("Invalid arguments, possible options: " << BENCH_OPTIONS);
+		return -1;
+	}
+
+	// the site is made in its own folder as tim builds sites from the current one
+	if(!config.dir.size())
+		config.dir = (std::filesystem::temp_directory_path(error_code) / "tim_bench").string();
+	std::filesystem::create_directories(config.dir, error_code);
+	std::filesystem::current_path(config.dir, error_code);
+	if(error_code != std::error_code())
+	{
+		log_failure(config.dir << " directory is NOT usable");
+		log_error_code;
+		return -1;
+	}
+
+	// everything tim logs is dropped so only measured code is timed
+	std::ostream  null_stream(nullptr);
+	std::ostream* bench_stream = log_stream;
+	log_stream                 = &null_stream;
+
+	SymbolTable symbols;
+	InitSymbols(symbols);
+
+	std::unique_ptr<Site> site = std::make_unique<Site>();
+	site->name                 = BENCH_SITE_NAME;
+	site->symbols              = &symbols;
+	InitDirs(site.get());
+
+	log_stream = bench_stream;
+	log_line("pages: " << config.pages << ", depth: " << config.depth << ", fanout: " << config.fanout << ", content size: " << config.content_size
+	                   << ", placeholders per KB: " << config.placeholders << ", assets: " << config.assets << ", runs: " << config.runs
+	                   << ", seed: " << config.seed << ", jobs: " << (options.jobs ? std::to_string(options.jobs) : "auto"));
+	log_line("site: " << site->directory << "\n");
+	log_stream = &null_stream;
+
+	bool                    ok = GenerateBenchSite(site.get(), config);
+	std::deque<BenchResult> results; // references to results stay valid when more are added
+	auto                    add = [&](std::string name, const char* unit, const std::function<bool()>& setup, const std::function<bool()>& task) -> BenchResult& {
+		results.emplace_back();
+		BenchResult& result = results.back();
+		result.name         = name;
+		result.unit         = unit;
+		if(ok && !Measure(result, config.runs, setup, task))
+		{
+			ok         = false;
+			log_stream = bench_stream;
+			log_failure(name << " benchmark was NOT successful");
+			log_stream = &null_stream;
+		}
+		return result;
+	};
+	auto build_site = [&]() {
+		SiteBuild build;
+		return BuildSite(site.get(), build);
+	};
+	auto full_build = [&]() {
+		options.full = true;
+		bool result  = build_site();
+		options.full = false;
+		return result;
+	};
+
+	// end to end tasks
+	BenchResult& build_full      = add("build --full", "pages", nullptr, full_build);
+	BenchResult& build_unchanged = add("build unchanged", "files", nullptr, build_site);
+	BenchResult& pack            = add("pack", "files", full_build, [&]() { return PackSite(site.get()); });
+	BenchResult& info            = add("info", "calls", nullptr, [&]() { return InfoSite(site.get()); });
+
+	// output is built again as pack has changed it
+	ok                   = ok && full_build();
+	uint64_t page_files  = 0;
+	uint64_t asset_files = 0;
+	uint64_t page_bytes  = GetFolderBytes(site->output_dir, {".html"}, page_files);
+	uint64_t asset_bytes = GetFolderBytes(site->feed_dir, {".css", ".js", ".png"}, asset_files);
+
+	build_full.items      = page_files;
+	build_full.bytes      = page_bytes;
+	build_unchanged.items = page_files + asset_files; // checked, none of them is written
+	pack.bytes            = GetFolderBytes(site->output_dir, {".html", ".css", ".js"}, pack.items);
+	info.items            = 1;
+
+	// phases of a build, each measured alone on a single thread
+	SiteBuild build;
+	InputCache cache;
+	ok = ok && LoadSiteInputs(site.get(), build, cache);
+	ScanFeed(site.get(), build.tree);
+	WriteNavLinks(site.get(), build.tree);
+	SpecializeBase(site.get(), build);
+
+	const unsigned data_reads = 1000;
+
+	BenchResult& read_data = add("ReadDataFile", "calls", nullptr, [&]() {
+		bool result = true;
+		for(unsigned i = 0; i < data_reads; ++i)
+		{
+			DataFile data;
+			result = ReadDataFile(site->data_file_dir, *site->symbols, data) && result;
+		}
+		return result;
+	});
+	read_data.items = data_reads;
+	read_data.bytes = data_reads * (uint64_t)std::filesystem::file_size(site->data_file_dir, error_code);
+
+	std::vector<unsigned> assets;
+	for(unsigned index = 1; index < build.tree.nodes.size(); ++index)
+		if(!build.tree.nodes[index].is_dir && !build.tree.nodes[index].is_html)
+			assets.push_back(index);
+	auto remove_assets = [&]() {
+		for(unsigned index : assets)
+			std::filesystem::remove(site->output_dir + PATH_SEPARATOR + build.tree.nodes[index].rel_dir, error_code);
+		return true;
+	};
+	BenchResult& feed_copy = add("feed copy", "files", remove_assets, [&]() {
+		bool result = true;
+		for(unsigned index : assets)
+		{
+			const std::string& rel_dir = build.tree.nodes[index].rel_dir;
+			result                     = CopyFeedFile(site->feed_dir + PATH_SEPARATOR + rel_dir, site->output_dir + PATH_SEPARATOR + rel_dir, GetValue(site->config, SYMBOL_COPY_MODE)) && result;
+		}
+		return result;
+	});
+	feed_copy.items = asset_files;
+	feed_copy.bytes = asset_bytes;
+
+	std::vector<Page> pages;
+	for(unsigned index = 1; index < build.tree.nodes.size(); ++index)
+	{
+		const SiteNode& node = build.tree.nodes[index];
+		if(node.is_html)
+			pages.push_back({site->output_dir + PATH_SEPARATOR + node.rel_dir, site->feed_dir + PATH_SEPARATOR + node.rel_dir, node.rel_dir, node.parent});
+	}
+	BenchResult& generate = add("GenerateHTMLFile", "pages", nullptr, [&]() {
+		bool result = true;
+		for(const Page& page : pages)
+			result = GenerateHTMLFile(build, page, site.get()) && result;
+		return result;
+	});
+	generate.items = pages.size();
+	generate.bytes = page_bytes;
+
+	// pages rendered into memory, so writing files does not hide the cost of tokens,
+	// with _base.html specialized for the build and then with every value of the site evaluated for every page
+	std::string       rendered;
+	std::vector<Page> memory_pages = pages;
+	for(Page& page : memory_pages)
+		page.rendered = &rendered;
+	auto render_pages = [&]() {
+		bool result = true;
+		for(const Page& page : memory_pages)
+		{
+			rendered.clear();
+			result = GenerateHTMLFile(build, page, site.get()) && result;
+		}
+		return result;
+	};
+	BenchResult& render_folded = add("render folded", "pages", nullptr, render_pages);
+	render_folded.items        = pages.size();
+	render_folded.bytes        = page_bytes;
+
+	std::shared_ptr<const Template> page_base = build.page_base;
+	build.page_base                           = nullptr;
+	BenchResult& render_unfolded              = add("render unfolded", "pages", nullptr, render_pages);
+	render_unfolded.items                     = pages.size();
+	render_unfolded.bytes                     = page_bytes;
+	build.page_base                           = page_base;
+
+	// content files read like changed ones in UpdateOutput, one after another and then with io_uring
+	std::vector<std::string> content_files;
+	uint64_t                 content_bytes = 0;
+	for(const Page& page : pages)
+	{
+		content_files.push_back(page.content_dir);
+		content_bytes += std::filesystem::file_size(page.content_dir, error_code);
+	}
+	auto read_content = [&](bool io_uring) {
+		return [&, io_uring]() {
+			std::vector<char> read;
+			uint64_t          flags = 0;
+			uint64_t          hash  = 0;
+			bool              last  = options.io_uring;
+			options.io_uring        = io_uring;
+			ReadFiles(
+			    content_files, [&](std::size_t, std::string_view data) { GetDataListingFlags(data, flags, hash); }, read);
+			options.io_uring = last;
+			return std::find(read.begin(), read.end(), false) == read.end();
+		};
+	};
+	BenchResult& read_blocking = add("ReadFiles blocking", "files", nullptr, read_content(false));
+	BenchResult& read_ring     = add("ReadFiles io_uring", "files", nullptr, read_content(true));
+	read_blocking.items        = content_files.size();
+	read_blocking.bytes        = content_bytes;
+	read_ring.items            = content_files.size();
+	read_ring.bytes            = content_bytes;
+
+	BenchResult& scan = add("ScanFeed", "nodes", nullptr, [&]() {
+		ScanFeed(site.get(), build.tree);
+		return true;
+	});
+	scan.items = build.tree.nodes.size();
+
+	BenchResult& nav = add("nav writers", "dirs", nullptr, [&]() {
+		WriteNavLinks(site.get(), build.tree);
+		return true;
+	});
+	nav.bytes = build.tree.feed_links.size();
+	for(const SiteNode& node : build.tree.nodes)
+	{
+		if(!node.is_dir)
+			continue;
+		++nav.items;
+		nav.bytes += node.prev_links.size() + node.next_links.size() + node.page_links.size();
+	}
+
+	log_stream = bench_stream;
+	PrintResults(results);
+	if(!config.keep)
+		std::filesystem::remove_all(site->directory, error_code);
+
+	if(!ok)
+	{
+		log_failure("Benchmarks were NOT successful");
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,4450 @@
+// ==================================================
+// file: tim.cpp
+// project: Tim Site Generator
+// author: Paulina Kalicka
+// ==================================================
+
+#include "tim.h"
+
+thread_local std::error_code error_code;
+
+std::ostream*              log_output = &std::cout;
+thread_local std::ostream* log_stream = log_output;
+
+LogLevel log_level = LogLevel::NORMAL;
+Options  options;
+Profile  profile;
+
+/////////////////////////////////////////////////////
+// < HELPFUL FUNCTIONS
+
+/* get a small number of the current thread, the same for all its events */
+static unsigned GetProfileThread()
+{
+	static std::atomic<unsigned> threads(0);
+	thread_local unsigned        thread = ++threads;
+	return thread;
+}
+
+/* nanoseconds between two points in time */
+static uint64_t GetNanoseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+ProfileScope::ProfileScope(const char* name, const std::string& detail)
+    : name(name)
+{
+	if(!options.profile)
+		return;
+	this->detail = detail;
+	begin        = std::chrono::steady_clock::now();
+}
+
+ProfileScope::~ProfileScope()
+{
+	if(!options.profile)
+		return;
+	auto         end = std::chrono::steady_clock::now();
+	ProfileEvent event;
+	event.name     = name;
+	event.detail   = std::move(detail);
+	event.begin    = GetNanoseconds(profile.start, begin);
+	event.duration = GetNanoseconds(begin, end);
+	event.thread   = GetProfileThread();
+
+	std::lock_guard<std::mutex> lock(profile.mutex);
+	profile.events.push_back(std::move(event));
+}
+
+/* get a name of a token type as it is written in templates */
+static const char* GetTokenTypeName(TokenType type)
+{
+	switch(type)
+	{
+		case TokenType::TEXT: return "text";
+		case TokenType::CONTENT: return "_content";
+		case TokenType::NAME: return "_name";
+		case TokenType::URL: return "_url";
+		case TokenType::THIS_URL: return "_this_url";
+		case TokenType::TITLE: return "_title";
+		case TokenType::PREV_LINKS: return "_prev_links";
+		case TokenType::NEXT_LINKS: return "_next_links";
+		case TokenType::FEED_LINKS: return "_feed_links";
+		case TokenType::PAGE_LINKS: return "_page_links";
+		case TokenType::IF: return "_if";
+		case TokenType::IFNOT: return "_ifnot";
+		case TokenType::ENDIF: return "_endif";
+		case TokenType::SITE_DATA: return ":data";
+		case TokenType::PAGE_DATA: return "+data";
+		case TokenType::INCLUDE: return "=include";
+		case TokenType::UNDEFINED_DATA: return "undefined data";
+		case TokenType::UNDEFINED_TOKEN: return "undefined token";
+	}
+	return "";
+}
+
+/* get a symbol of a name, a new name gets the next number */
+static unsigned InternSymbol(SymbolTable& symbols, const std::string& name)
+{
+	auto found = symbols.ids.find(name);
+	if(found != symbols.ids.end())
+		return found->second;
+	unsigned symbol = (unsigned)symbols.names.size();
+	symbols.ids.emplace(name, symbol);
+	symbols.names.push_back(name);
+	return symbol;
+}
+
+/* get a symbol of a name without adding it,
+ so the table can be read by many threads generating pages */
+static unsigned FindSymbol(const SymbolTable& symbols, const std::string& name)
+{
+	auto found = symbols.ids.find(name);
+	return (found != symbols.ids.end()) ? (found->second) : (NO_SYMBOL);
+}
+
+/* empty given table and add symbols known before any file is read */
+void InitSymbols(SymbolTable& symbols)
+{
+	symbols = SymbolTable();
+	for(const char* name : PREDEFINED_SYMBOL_NAMES)
+		InternSymbol(symbols, name);
+}
+
+/* get a value from a data file, empty if it is not defined */
+const std::string& GetValue(const DataFile& data_file, unsigned symbol)
+{
+	static const std::string empty;
+	return (symbol < data_file.values.size()) ? (data_file.values[symbol]) : (empty);
+}
+
+/* get a value from data of a page, the last one if a key is given twice */
+static std::string_view GetValue(const PageData& data, const Token& token)
+{
+	for(std::size_t i = data.size; i--;)
+	{
+		const PageData::Item& item = data.items[i];
+		if((token.symbol != NO_SYMBOL) ? (item.symbol == token.symbol) : (item.key == token.text))
+			return item.value;
+	}
+	return std::string_view();
+}
+
+constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+/* FNV-1a hash of given bytes, optionally continuing given hash */
+static uint64_t HashBytes(const char* bytes, std::size_t size, uint64_t hash = HASH_SEED)
+{
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= (unsigned char)bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+/* continue the hash with a number */
+static uint64_t HashCombine(uint64_t hash, uint64_t value)
+{
+	return HashBytes((const char*)&value, sizeof(value), hash);
+}
+
+/* copy a file from _feed folder to the output folder the way given by copy_mode from _config.txt:
+ - reflink: the copy shares data with the original until one of them is changed
+ - hardlink: both folders have the same file, changing one changes the other
+ - copy: bytes are copied by the kernel (copy_file_range) or read and written if it is not possible
+ - auto (default): reflink if the filesystem supports it, copy otherwise */
+bool CopyFeedFile(std::string from, std::string to, const std::string& mode)
+{
+	ProfileScope scope("CopyFeedFile", to);
+
+	// a new file is always created so a hardlink from an earlier build never changes _feed folder
+	std::filesystem::remove(to, error_code);
+
+	if(mode == "hardlink")
+	{
+		std::filesystem::create_hard_link(from, to, error_code);
+		if(error_code == std::error_code())
+			return true;
+	}
+
+#ifdef __linux__
+	int from_fd = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+	if(from_fd >= 0)
+	{
+		struct stat from_stat;
+		int         to_fd  = -1;
+		bool        copied = false;
+		if(fstat(from_fd, &from_stat) == 0)
+			to_fd = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, from_stat.st_mode & 0777);
+		if(to_fd >= 0)
+		{
+			if((mode != "copy") && (ioctl(to_fd, FICLONE, from_fd) == 0))
+				copied = true;
+			else if(mode != "reflink")
+			{
+				off_t left = from_stat.st_size;
+				while(left > 0)
+				{
+					ssize_t size = copy_file_range(from_fd, nullptr, to_fd, nullptr, (std::size_t)left, 0);
+					if(size <= 0)
+						break;
+					left -= size;
+				}
+				copied = !left;
+			}
+			close(to_fd);
+		}
+		close(from_fd);
+		if(copied)
+			return true;
+		std::filesystem::remove(to, error_code);
+	}
+#endif
+
+	std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing, error_code);
+	log_error_code;
+	return error_code == std::error_code();
+}
+
+/* open a file to read it as a whole, return false if it cannot be open */
+static bool MapFile(MappedFile& file, std::string file_dir)
+{
+#ifdef __linux__
+	int fd = open(file_dir.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+		return false;
+	struct stat file_stat;
+	if((fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0))
+	{
+		void* data = mmap(nullptr, (std::size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data != MAP_FAILED)
+		{
+			// pages are read once from the beginning to the end
+			madvise(data, (std::size_t)file_stat.st_size, MADV_SEQUENTIAL);
+			file.data   = std::string_view((const char*)data, (std::size_t)file_stat.st_size);
+			file.mapped = true;
+		}
+	}
+	close(fd);
+	if(file.mapped)
+		return true;
+#endif
+	// empty files and files that cannot be mapped are read at once
+	std::ifstream stream(file_dir);
+	if(!stream.is_open())
+		return false;
+	file.buffer.assign((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	file.data = file.buffer;
+	return true;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef __linux__
+	if(mapped)
+		munmap((void*)data.data(), data.size());
+#endif
+}
+
+#ifdef __linux__
+/* unmap rings of io_uring and close it */
+static void CloseIoRing(IoRing& ring)
+{
+	if(ring.sqes_map != MAP_FAILED)
+		munmap(ring.sqes_map, ring.sqes_size);
+	if((ring.cq_map != MAP_FAILED) && (ring.cq_map != ring.sq_map))
+		munmap(ring.cq_map, ring.cq_size);
+	if(ring.sq_map != MAP_FAILED)
+		munmap(ring.sq_map, ring.sq_size);
+	if(ring.fd >= 0)
+		close(ring.fd);
+	ring = IoRing();
+}
+
+/* set up io_uring with at least given number of entries, false if the kernel does not allow it */
+static bool OpenIoRing(IoRing& ring, unsigned entries)
+{
+	io_uring_params params = {};
+	ring.fd                = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if(ring.fd < 0)
+		return false;
+
+	// new kernels map both rings at once
+	bool single    = (params.features & IORING_FEAT_SINGLE_MMAP);
+	ring.entries   = params.sq_entries;
+	ring.sq_size   = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring.cq_size   = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	ring.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	if(single)
+		ring.sq_size = ring.cq_size = std::max(ring.sq_size, ring.cq_size);
+	ring.sq_map   = mmap(nullptr, ring.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+	ring.cq_map   = (single) ? (ring.sq_map) : (mmap(nullptr, ring.cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING));
+	ring.sqes_map = mmap(nullptr, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+	if((ring.sq_map == MAP_FAILED) || (ring.cq_map == MAP_FAILED) || (ring.sqes_map == MAP_FAILED))
+	{
+		CloseIoRing(ring);
+		return false;
+	}
+
+	char* sq      = (char*)ring.sq_map;
+	char* cq      = (char*)ring.cq_map;
+	ring.sq_head  = (unsigned*)(sq + params.sq_off.head);
+	ring.sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+	ring.sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring.sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring.sqes     = (io_uring_sqe*)ring.sqes_map;
+	ring.cq_head  = (unsigned*)(cq + params.cq_off.head);
+	ring.cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+	ring.cq_mask  = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring.cqes     = (io_uring_cqe*)(cq + params.cq_off.cqes);
+	ring.tail     = *ring.sq_tail;
+	return true;
+}
+
+/* get a cleared entry of the submission queue, nullptr if the queue is full */
+static io_uring_sqe* GetIoRingEntry(IoRing& ring)
+{
+	if(ring.tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) >= ring.entries)
+		return nullptr;
+	unsigned      index = ring.tail++ & *ring.sq_mask;
+	io_uring_sqe* entry = &ring.sqes[index];
+	std::memset(entry, 0, sizeof(io_uring_sqe));
+	ring.sq_array[index] = index;
+	return entry;
+}
+
+/* give new entries to the kernel and wait until at least one operation is complete */
+static bool SubmitIoRing(IoRing& ring)
+{
+	unsigned count = ring.tail - *ring.sq_tail;
+	__atomic_store_n(ring.sq_tail, ring.tail, __ATOMIC_RELEASE);
+	while(syscall(__NR_io_uring_enter, ring.fd, count, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+	{
+		// entries are taken before waiting, so only waiting is done again
+		if(errno != EINTR)
+			return false;
+		count = 0;
+	}
+	return true;
+}
+
+/* read files with io_uring: up to IO_RING_DEPTH files are open or read at once,
+ false if io_uring is not possible, files that were not read are given to the caller to read */
+static bool ReadFilesWithIoRing(const std::vector<std::string>& files, const std::function<void(std::size_t, std::string_view)>& task, std::vector<char>& read)
+{
+	IoRing ring;
+	if(!OpenIoRing(ring, IO_RING_DEPTH))
+		return false;
+
+	// every slot has one file and one operation in flight, user data of the operation is the slot
+	struct Slot
+	{
+		std::size_t file = 0;
+		int         fd   = -1; // -1 while the file is being open
+		std::string data;
+		std::size_t offset = 0;
+	};
+	std::vector<Slot> slots(ring.entries);
+	std::size_t       next      = 0;
+	unsigned          active    = 0;
+	uint64_t          queued    = 0; // operations put into the submission queue
+	uint64_t          completed = 0;
+	auto              open_next = [&](unsigned slot) {
+		if(next >= files.size())
+			return false;
+		Slot&         item  = slots[slot];
+		io_uring_sqe* entry = GetIoRingEntry(ring);
+		item.file           = next++;
+		item.fd             = -1;
+		item.offset         = 0;
+		entry->opcode       = IORING_OP_OPENAT;
+		entry->fd           = AT_FDCWD;
+		entry->addr         = (uint64_t)(uintptr_t)files[item.file].c_str();
+		entry->open_flags   = O_RDONLY | O_CLOEXEC;
+		entry->user_data    = slot;
+		++queued;
+		return true;
+	};
+	auto read_rest = [&](unsigned slot) {
+		Slot&         item  = slots[slot];
+		io_uring_sqe* entry = GetIoRingEntry(ring);
+		entry->opcode       = IORING_OP_READ;
+		entry->fd           = item.fd;
+		entry->addr         = (uint64_t)(uintptr_t)(item.data.data() + item.offset);
+		entry->len          = (unsigned)std::min<std::size_t>(item.data.size() - item.offset, 1u << 30);
+		entry->off          = item.offset;
+		entry->user_data    = slot;
+		++queued;
+	};
+
+	// completions are taken from the ring, without keep only so that nothing is in flight anymore
+	auto reap = [&](bool keep) {
+		unsigned head = *ring.cq_head;
+		unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for(; head != tail; ++head)
+		{
+			const io_uring_cqe& completion = ring.cqes[head & *ring.cq_mask];
+			unsigned            slot       = (unsigned)completion.user_data;
+			Slot&               item       = slots[slot];
+			bool                done       = true;
+			++completed;
+			if(!keep)
+			{
+				if((item.fd < 0) && (completion.res >= 0))
+					close(completion.res);
+				continue;
+			}
+			if((item.fd < 0) && (completion.res >= 0))
+			{
+				// the size is known at once, so the file is read in one operation unless it is huge,
+				// a file too big to be kept in memory many times is left to be mapped by the caller
+				struct stat file_stat;
+				item.fd    = completion.res;
+				bool known = (fstat(item.fd, &file_stat) == 0) && (file_stat.st_size <= IO_RING_FILE_LIMIT);
+				if(known && (file_stat.st_size > 0))
+				{
+					item.data.resize((std::size_t)file_stat.st_size);
+					read_rest(slot);
+					done = false;
+				}
+				else if(known)
+				{
+					read[item.file] = true;
+					task(item.file, std::string_view());
+				}
+			}
+			else if(item.fd >= 0)
+			{
+				// a file that got shorter is read up to its new end
+				if(completion.res > 0)
+					item.offset += (std::size_t)completion.res;
+				if((completion.res > 0) && (item.offset < item.data.size()))
+				{
+					read_rest(slot);
+					done = false;
+				}
+				else if(completion.res >= 0)
+				{
+					read[item.file] = true;
+					task(item.file, std::string_view(item.data.data(), item.offset));
+				}
+			}
+			if(!done)
+				continue;
+			if(item.fd >= 0)
+				close(item.fd);
+			item.fd = -1;
+			if(!open_next(slot))
+				--active;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	};
+	for(unsigned slot = 0; slot < slots.size(); ++slot)
+		active += open_next(slot);
+
+	bool failed = false;
+	while(active && !failed)
+	{
+		failed = !SubmitIoRing(ring);
+		if(!failed)
+			reap(true);
+	}
+
+	// operations the kernel has taken still write into buffers of slots, so they are waited for
+	if(failed)
+	{
+		log_verbose("io_uring has failed, files are read one after another");
+		unsigned not_taken = ring.tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+		while(completed + not_taken < queued)
+		{
+			if((syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) && (errno != EINTR))
+			{
+				pollfd ring_poll = {ring.fd, POLLIN, 0};
+				poll(&ring_poll, 1, -1);
+			}
+			reap(false);
+		}
+	}
+
+	CloseIoRing(ring);
+	for(const Slot& item : slots)
+		if(item.fd >= 0)
+			close(item.fd);
+	return true;
+}
+#endif
+
+/* read whole files and give each of them to a task as soon as it is read, in any order:
+ with --io-uring many files are open and read at once, otherwise they are read one after another,
+ read tells which files were read */
+void ReadFiles(const std::vector<std::string>& files, const std::function<void(std::size_t, std::string_view)>& task, std::vector<char>& read)
+{
+	read.assign(files.size(), false);
+#ifdef __linux__
+	if(options.io_uring && files.size() && !ReadFilesWithIoRing(files, task, read))
+		log_verbose("io_uring is NOT possible, files are read one after another");
+#endif
+
+	// a file io_uring could not open, e.g. on an old kernel without IORING_OP_OPENAT, gets another try
+	for(std::size_t i = 0; i < files.size(); ++i)
+	{
+		MappedFile file;
+		if(!read[i] && MapFile(file, files[i]))
+		{
+			read[i] = true;
+			task(i, file.data);
+		}
+	}
+}
+
+/* create or truncate a file to write it in chunks */
+static bool OpenOutputFile(OutputFile& file, std::string file_dir)
+{
+#ifdef __linux__
+	file.fd = open(file_dir.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	return file.fd >= 0;
+#else
+	file.file.open(file_dir, std::ios::binary);
+	return file.file.is_open();
+#endif
+}
+
+/* write the next chunk of an open file */
+static bool WriteOutputFile(OutputFile& file, std::string_view str_data)
+{
+#ifdef __linux__
+	const char* data = str_data.data();
+	std::size_t left = str_data.size();
+	while(left)
+	{
+		ssize_t size = write(file.fd, data, left);
+		if(size <= 0)
+			return false;
+		data += size;
+		left -= (std::size_t)size;
+	}
+	return true;
+#else
+	file.file.write(str_data.data(), str_data.size());
+	return (bool)file.file;
+#endif
+}
+
+/* close a written file, return false if not everything was written */
+static bool CloseOutputFile(OutputFile& file)
+{
+#ifdef __linux__
+	bool result = (close(file.fd) == 0);
+	file.fd     = -1;
+	return result;
+#else
+	file.file.close();
+	return (bool)file.file;
+#endif
+}
+
+/* write a whole file at once, return false if it cannot be written */
+bool WriteFile(std::string file_dir, const std::string& str_data)
+{
+	ProfileScope scope("WriteFile", file_dir);
+
+	OutputFile file;
+	if(!OpenOutputFile(file, file_dir))
+		return false;
+	bool written = WriteOutputFile(file, str_data);
+	return CloseOutputFile(file) && written;
+}
+
+/* check if a file has exactly given bytes, false if it cannot be read */
+static bool HasFileData(std::string file_dir, std::string_view data)
+{
+	if(std::filesystem::file_size(file_dir, error_code) != data.size())
+		return false;
+	MappedFile file;
+	return MapFile(file, file_dir) && (file.data == data);
+}
+
+/* check if two files have the same bytes */
+static bool HaveSameData(std::string file_dir, std::string other_dir)
+{
+	if(std::filesystem::file_size(file_dir, error_code) != std::filesystem::file_size(other_dir, error_code))
+		return false;
+	MappedFile file;
+	return MapFile(file, file_dir) && HasFileData(other_dir, file.data);
+}
+
+/* append a string to JSON output with quotes and escaped characters */
+static void WriteJSONString(std::string& output, const std::string& str)
+{
+	output += '"';
+	for(char c : str)
+	{
+		if((c == '"') || (c == '\\'))
+			output.append(1, '\\').append(1, c);
+		else if((unsigned char)c < 0x20)
+		{
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+			output += escaped;
+		}
+		else
+			output += c;
+	}
+	output += '"';
+}
+
+/* write measured events in the trace event format that trace viewers (chrome://tracing, Perfetto) open */
+static bool WriteProfileTrace(std::string file_dir, const std::vector<ProfileEvent>& events)
+{
+	std::string output = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	char        number[64];
+	for(std::size_t i = 0; i < events.size(); ++i)
+	{
+		const ProfileEvent& event = events[i];
+		output += (i) ? (",\n{\"name\":") : ("\n{\"name\":");
+		WriteJSONString(output, event.name);
+		std::snprintf(number, sizeof(number), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u", event.thread);
+		output += number;
+		std::snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f", event.begin / 1000.0, event.duration / 1000.0);
+		output += number;
+		if(event.detail.size())
+		{
+			output += ",\"args\":{\"detail\":";
+			WriteJSONString(output, event.detail);
+			output += '}';
+		}
+		output += '}';
+	}
+	output += "\n]}\n";
+	return WriteFile(file_dir, output);
+}
+
+/* print a summary of everything measured with --profile: time of phases,
+ the slowest pages and time spent on every type of token, and write a trace if it was asked for */
+void ReportProfile()
+{
+	std::vector<ProfileEvent> events;
+	{
+		std::lock_guard<std::mutex> lock(profile.mutex);
+		events = profile.events;
+	}
+	// events are added when they end, so inner ones come first
+	std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) { return (a.begin != b.begin) ? (a.begin < b.begin) : (a.duration > b.duration); });
+	uint64_t wall = GetNanoseconds(profile.start, std::chrono::steady_clock::now());
+
+	struct Phase
+	{
+		const char* name;
+		uint64_t    calls = 0;
+		uint64_t    total = 0;
+		uint64_t    max   = 0;
+	};
+	std::vector<Phase>                      phases;
+	std::unordered_map<std::string, size_t> phase_indexes;
+	std::vector<const ProfileEvent*>        pages;
+	for(const ProfileEvent& event : events)
+	{
+		auto found = phase_indexes.emplace(event.name, phases.size());
+		if(found.second)
+			phases.push_back({event.name});
+		Phase& phase = phases[found.first->second];
+		++phase.calls;
+		phase.total += event.duration;
+		phase.max = std::max(phase.max, event.duration);
+		if(!std::strcmp(event.name, "GenerateHTMLFile"))
+			pages.push_back(&event);
+	}
+
+	char line[512];
+	log_report("\n########## Profile ##########");
+	std::snprintf(line, sizeof(line), "Wall time: %.3f ms, events: %zu", wall / 1e6, events.size());
+	log_report(line);
+
+	log_report("\n### Phases (time on all threads)");
+	std::snprintf(line, sizeof(line), "%-22s %10s %14s %12s", "phase", "calls", "total ms", "max ms");
+	log_report(line);
+	for(const Phase& phase : phases)
+	{
+		std::snprintf(line, sizeof(line), "%-22s %10llu %14.3f %12.3f", phase.name, (unsigned long long)phase.calls, phase.total / 1e6, phase.max / 1e6);
+		log_report(line);
+	}
+
+	log_report("\n### Slowest pages");
+	std::size_t top = std::min<std::size_t>(pages.size(), PROFILE_TOP_PAGES);
+	std::partial_sort(pages.begin(), pages.begin() + top, pages.end(), [](const ProfileEvent* a, const ProfileEvent* b) { return a->duration > b->duration; });
+	for(std::size_t i = 0; i < top; ++i)
+	{
+		std::snprintf(line, sizeof(line), "%12.3f ms  %s", pages[i]->duration / 1e6, pages[i]->detail.c_str());
+		log_report(line);
+	}
+
+	log_report("\n### Tokens (content is measured by its own tokens, folded ones were written into _base.html once per build)");
+	std::snprintf(line, sizeof(line), "%-22s %12s %14s %10s %12s", "token", "count", "total ms", "ns each", "folded");
+	log_report(line);
+	for(std::size_t type = 0; type < TOKEN_TYPES; ++type)
+	{
+		uint64_t count  = profile.token_count[type];
+		uint64_t folded = profile.token_folded[type];
+		if(!count && !folded)
+			continue;
+		uint64_t time = profile.token_time[type];
+		std::snprintf(line, sizeof(line), "%-22s %12llu %14.3f %10llu %12llu", GetTokenTypeName((TokenType)type), (unsigned long long)count, time / 1e6,
+		              (unsigned long long)((count) ? (time / count) : (0)), (unsigned long long)folded);
+		log_report(line);
+	}
+	log_report("#############################\n");
+
+	if(options.trace_file_dir.size())
+	{
+		if(WriteProfileTrace(options.trace_file_dir, events))
+			log_success("Trace was written to " << options.trace_file_dir);
+		else
+			log_failure("Trace file " << options.trace_file_dir << " was NOT written");
+	}
+}
+
+/* convert a string with only digits to a number */
+bool ParseUnsigned(std::string str, unsigned& value)
+{
+	if(!str.size() || (str.size() > 9))
+		return false;
+	value = 0;
+	for(char ch : str)
+	{
+		if((ch < '0') || (ch > '9'))
+			return false;
+		value = value * 10 + (ch - '0');
+	}
+	return true;
+}
+
+/* run task for every index from 0 to count-1 using the given number of threads:
+ every thread takes indexes from the front of its own queue and when it is empty
+ it steals from the back of queues of other threads */
+static void RunParallel(std::size_t count, unsigned jobs, const std::function<void(std::size_t)>& task)
+{
+	if(!jobs)
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	if(jobs > count)
+		jobs = (unsigned)count;
+	if(jobs <= 1)
+	{
+		for(std::size_t i = 0; i < count; ++i)
+			task(i);
+		return;
+	}
+
+	struct Queue
+	{
+		std::mutex              mutex;
+		std::deque<std::size_t> indexes;
+	};
+	std::vector<Queue> queues(jobs);
+	for(std::size_t i = 0; i < count; ++i)
+		queues[i * jobs / count].indexes.push_back(i);
+
+	auto worker = [&](unsigned id) {
+		while(true)
+		{
+			std::size_t index = 0;
+			bool        found = false;
+			for(unsigned n = 0; (n < jobs) && !found; ++n)
+			{
+				Queue&                      queue = queues[(id + n) % jobs];
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				if(queue.indexes.size())
+				{
+					found = true;
+					if(!n)
+					{
+						index = queue.indexes.front();
+						queue.indexes.pop_front();
+					}
+					else
+					{
+						index = queue.indexes.back();
+						queue.indexes.pop_back();
+					}
+				}
+			}
+			if(!found)
+				return;
+			task(index);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(unsigned id = 1; id < jobs; ++id)
+		threads.emplace_back(worker, id);
+	worker(0);
+	for(std::thread& thread : threads)
+		thread.join();
+}
+
+/* run task for every index in parallel like RunParallel, but every task logs into its own buffer
+ and logs are printed in the order of indexes so they do not depend on which thread run which task,
+ return false if any task failed */
+static bool RunParallelLogged(std::size_t count, const std::function<bool(std::size_t)>& task, std::vector<char>& results)
+{
+	std::vector<std::string> logs(count);
+	results.assign(count, false);
+	RunParallel(count, options.jobs, [&](std::size_t i) {
+		std::ostringstream task_log;
+		std::ostream*      prev_stream = log_stream;
+		log_stream                     = &task_log;
+		results[i]                     = task(i);
+		log_stream                     = prev_stream;
+		logs[i]                        = task_log.str();
+	});
+
+	// every message was already filtered by its level when it was logged, so failures are kept with --quiet
+	bool result = true;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		*log_stream << logs[i];
+		if(!results[i])
+			result = false;
+	}
+	return result;
+}
+
+/**/
+static std::string GetWithoutHTMLExtension(std::string filename)
+{
+	std::string name = filename;
+	name.erase(name.end() - 5, name.end());
+	return name;
+}
+
+/* split string with given delimer and return vector with string values */
+static std::vector<std::string> SplitString(std::string str, char del)
+{
+	std::vector<std::string> vec;
+	std::string              word;
+	unsigned                 size = str.size();
+	char                     ch;
+
+	for(unsigned i = 0; i < size; ++i)
+	{
+		ch = str.at(i);
+		if(ch == del)
+		{
+			vec.push_back(word);
+			word = "";
+		}
+		else if((i == size - 1))
+		{
+			word += ch;
+			vec.push_back(word);
+			word = "";
+		}
+		else
+			word += ch;
+	}
+	return vec;
+}
+
+/* get a page's title: 
+ if file is an index file title is the parent directory name
+ otherwise title is just file name witout extension */
+static std::string GetCurrentTitle(std::string file_dir)
+{
+	std::filesystem::path path = std::filesystem::path(file_dir);
+	if(path.filename().string() == "index.html")
+		return path.parent_path().filename().string();
+	else
+		return GetWithoutHTMLExtension(path.filename().string());
+}
+
+/* get current file full final URL */
+static std::string GetCurrentURL(std::string baseURL, std::string curr_dir)
+{
+	std::string rel_dir = std::filesystem::relative(curr_dir, baseURL, error_code).parent_path().string();
+	log_error_code;
+	return baseURL + PATH_SEPARATOR + rel_dir;
+}
+
+/* initialize site's essential directories */
+void InitDirs(Site* site)
+{
+	site->directory = std::filesystem::current_path(error_code).string() + PATH_SEPARATOR + site->name;
+	log_error_code;
+	log_verbose("Directory: " << site->directory);
+
+	site->base_file_dir = site->directory + PATH_SEPARATOR + "_base.html";
+	log_verbose("Base file directory: " << site->base_file_dir);
+
+	site->feed_dir = site->directory + PATH_SEPARATOR + "_feed";
+	log_verbose("Feed directory: " << site->feed_dir);
+
+	site->index_file_dir = site->feed_dir + PATH_SEPARATOR + "index.html";
+	log_verbose("Main index.html file directory: " << site->index_file_dir);
+
+	site->output_dir = site->directory + PATH_SEPARATOR + site->name;
+	log_verbose("Output directory: " << site->output_dir);
+
+	site->data_file_dir = site->directory + PATH_SEPARATOR + "_data.txt";
+	log_verbose("Data file directory: " << site->data_file_dir);
+
+	site->config_file_dir = site->directory + PATH_SEPARATOR + "_config.txt";
+	log_verbose("Config file directory: " << site->config_file_dir);
+
+	site->manifest_file_dir = site->directory + PATH_SEPARATOR + "_manifest.txt";
+	log_verbose("Manifest file directory: " << site->manifest_file_dir);
+
+	site->compressed_file_dir = site->directory + PATH_SEPARATOR + "_compressed.txt";
+	log_verbose("Compressed files list directory: " << site->compressed_file_dir);
+
+	site->fingerprints_file_dir = site->directory + PATH_SEPARATOR + "_fingerprints.json";
+	log_verbose("Fingerprints file directory: " << site->fingerprints_file_dir);
+}
+
+/* write links to all directories the current directory is in */
+static void WritePrevLinks(const SiteTree& tree, unsigned dir, Site* site, std::string& output)
+{
+	ProfileScope scope("WritePrevLinks");
+
+	std::vector<unsigned> path;
+	for(unsigned node = dir; node; node = tree.nodes[node].parent)
+		path.push_back(node);
+	if(!path.size())
+		return;
+
+	const std::string& url = GetValue(site->data, SYMBOL_URL);
+	output += "<nav class=\"nav-links prev-links\" >";
+	for(auto it = path.rbegin(); it != path.rend(); ++it)
+	{
+		const SiteNode& node = tree.nodes[*it];
+		output.append("<a class=\"nav-link prev-link\" href=\"").append(url).append("/").append(node.rel_dir).append("\">").append(node.name).append("</a>");
+	}
+	output += "</nav>";
+}
+
+/* how pages get links to next folders and pages in their directory, from nav_mode and nav_page_size in _config.txt */
+struct NavOptions
+{
+	bool     fragments = false; // links are in files of _nav folder shown in an iframe, not in every page
+	unsigned page_size = 0;     // the most links in one part of a listing, 0 if it is not split
+};
+
+/* get how pages get links from the config of a site */
+static NavOptions GetNavOptions(Site* site)
+{
+	NavOptions nav;
+	nav.fragments = (GetValue(site->config, SYMBOL_NAV_MODE) == "fragment");
+	if(!ParseUnsigned(GetValue(site->config, SYMBOL_NAV_PAGE_SIZE), nav.page_size))
+		nav.page_size = 0;
+	return nav;
+}
+
+/* get a URL of a directory, with no slash at the end */
+static std::string GetDirURL(const SiteNode& node, Site* site)
+{
+	const std::string& url = GetValue(site->data, SYMBOL_URL);
+	return (node.rel_dir.size()) ? (url + "/" + node.rel_dir) : (url);
+}
+
+/* get a name of a file with a part of a listing in _nav folder */
+static std::string GetNavFileName(const char* kind, std::size_t part)
+{
+	return std::string(kind) + "_links-" + std::to_string(part + 1) + ".html";
+}
+
+/* write one part of a listing of given nodes,
+ prefix is put before names of nodes in links (a file in _nav folder links to "../name"),
+ a listing with more parts gets links to all of them */
+static void WriteListingPart(const SiteTree& tree, const std::vector<unsigned>& nodes, const char* kind, std::size_t part, unsigned page_size, const std::string& dir_url, const char* prefix, std::string& output)
+{
+	bool        pages = !std::strcmp(kind, "page");
+	std::size_t parts = (page_size) ? ((nodes.size() + page_size - 1) / page_size) : (1);
+	std::size_t begin = (page_size) ? (part * page_size) : (0);
+	std::size_t end   = (page_size) ? (std::min(nodes.size(), begin + page_size)) : (nodes.size());
+
+	output.append("<nav class=\"nav-links ").append(kind).append("-links\" >");
+	for(std::size_t i = begin; i < end; ++i)
+	{
+		const SiteNode& node = tree.nodes[nodes[i]];
+		output.append("<a class=\"nav-link ").append(kind).append("-link\" href=\"").append(prefix).append(node.name).append("\">");
+		output.append((pages) ? (GetWithoutHTMLExtension(node.name)) : (node.name)).append("</a>");
+	}
+	output += "</nav>";
+
+	if(parts < 2)
+		return;
+	output.append("<nav class=\"nav-links pager-links ").append(kind).append("-pager-links\" >");
+	for(std::size_t i = 0; i < parts; ++i)
+	{
+		output.append("<a class=\"nav-link pager-link").append((i == part) ? (" this-pager-link") : (""));
+		output.append("\" target=\"_self\" href=\"").append(dir_url).append("/_nav/").append(GetNavFileName(kind, i)).append("\">");
+		output.append(std::to_string(i + 1)).append("</a>");
+	}
+	output += "</nav>";
+}
+
+/* write a listing of given nodes into links every page of a directory has
+ and into files of _nav folder, if there are any */
+static void WriteListing(SiteTree& tree, const SiteNode& dir, const std::vector<unsigned>& nodes, const char* kind, const NavOptions& nav, const std::string& dir_url, std::string& output)
+{
+	if(!nodes.size())
+		return;
+	std::size_t parts = (nav.page_size) ? ((nodes.size() + nav.page_size - 1) / nav.page_size) : (1);
+	if(nav.fragments)
+		output.append("<iframe class=\"nav-frame ").append(kind).append("-links\" src=\"").append(dir_url).append("/_nav/").append(GetNavFileName(kind, 0)).append("\"></iframe>");
+	else
+		WriteListingPart(tree, nodes, kind, 0, nav.page_size, dir_url, "", output);
+	if(!nav.fragments && (parts < 2))
+		return;
+
+	// links in a file of _nav folder open in the whole window, only links to other parts open in its frame
+	std::string nav_dir = (dir.rel_dir.size()) ? (dir.rel_dir + PATH_SEPARATOR + "_nav") : ("_nav");
+	for(std::size_t part = 0; part < parts; ++part)
+	{
+		NavFile file;
+		file.name = nav_dir + PATH_SEPARATOR + GetNavFileName(kind, part);
+		file.text = "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><base target=\"_top\"></head><body>";
+		WriteListingPart(tree, nodes, kind, part, nav.page_size, dir_url, "../", file.text);
+		file.text += "</body></html>\n";
+		tree.nav_files.push_back(std::move(file));
+	}
+}
+
+/* write links to all next folders (not files) */
+static void WriteNextLinks(SiteTree& tree, unsigned dir, Site* site, const NavOptions& nav, std::string& output)
+{
+	ProfileScope scope("WriteNextLinks");
+
+	std::vector<unsigned> nodes;
+	for(unsigned child : tree.nodes[dir].children)
+		if(tree.nodes[child].is_dir)
+			nodes.push_back(child);
+	WriteListing(tree, tree.nodes[dir], nodes, "next", nav, GetDirURL(tree.nodes[dir], site), output);
+}
+
+/* write links to all folders/pages that are just after _feed directory */
+static void WriteFeedLinks(const SiteTree& tree, Site* site, std::string& output)
+{
+	ProfileScope scope("WriteFeedLinks");
+
+	const std::string& url = GetValue(site->data, SYMBOL_URL);
+	output += "<nav class=\"nav-links feed-links\" >";
+	output.append("<a class=\"nav-link feed-link site-link\" href=\"").append(url).append("\">").append(site->name).append("</a>");
+	for(unsigned child : tree.nodes[0].children)
+	{
+		const SiteNode& node = tree.nodes[child];
+		if(node.is_dir)
+			output.append("<a class=\"nav-link feed-link\" href=\"").append(url).append("/").append(node.name).append("\">").append(node.name).append("</a>");
+	}
+	output += "</nav>";
+}
+
+/* write links to all HTML files in the current directory */
+static void WritePageLinks(SiteTree& tree, unsigned dir, Site* site, const NavOptions& nav, std::string& output)
+{
+	ProfileScope scope("WritePageLinks");
+
+	bool                  write_index = (GetValue(site->config, SYMBOL_INDEX_PAGE) == "false") ? (false) : (true);
+	std::vector<unsigned> nodes;
+	for(unsigned child : tree.nodes[dir].children)
+	{
+		const SiteNode& node = tree.nodes[child];
+		if(node.is_html)
+		{
+			if((!write_index) && (node.name == "index.html")) continue;
+			nodes.push_back(child);
+		}
+	}
+	WriteListing(tree, tree.nodes[dir], nodes, "page", nav, GetDirURL(tree.nodes[dir], site), output);
+}
+
+/* get a hash of size and last write time of a file */
+static uint64_t GetFileStamp(const std::filesystem::directory_entry& entry)
+{
+	uint64_t stamp = HashCombine(HASH_SEED, entry.file_size(error_code));
+	return HashCombine(stamp, (uint64_t)entry.last_write_time(error_code).time_since_epoch().count());
+}
+
+/* walk _feed folder once and keep its structure in memory,
+ children of every directory are sorted by name */
+void ScanFeed(Site* site, SiteTree& tree)
+{
+	ProfileScope scope("ScanFeed");
+
+	tree.nodes.clear();
+	tree.nodes.emplace_back();
+	tree.nodes[0].is_dir = true;
+	tree.paths           = {{"", 0}};
+	for(const auto& feed_entry : std::filesystem::recursive_directory_iterator(site->feed_dir, error_code))
+	{
+		log_error_code;
+		SiteNode node;
+		node.is_dir = feed_entry.is_directory(error_code);
+		if(!node.is_dir && !feed_entry.is_regular_file(error_code))
+			continue;
+		node.name    = feed_entry.path().filename().string();
+		node.rel_dir = std::filesystem::relative(feed_entry.path(), site->feed_dir, error_code).string();
+		node.is_html = !node.is_dir && (feed_entry.path().extension().string() == ".html");
+		if(!node.is_dir)
+			node.stamp = GetFileStamp(feed_entry);
+
+		auto parent = tree.paths.find(std::filesystem::path(node.rel_dir).parent_path().string());
+		if(parent == tree.paths.end())
+			continue;
+		node.parent              = parent->second;
+		unsigned index           = (unsigned)tree.nodes.size();
+		tree.paths[node.rel_dir] = index;
+		tree.nodes[node.parent].children.push_back(index);
+		tree.nodes.push_back(std::move(node));
+	}
+
+	for(SiteNode& node : tree.nodes)
+		std::sort(node.children.begin(), node.children.end(), [&](unsigned a, unsigned b) { return tree.nodes[a].name < tree.nodes[b].name; });
+}
+
+/* write navigation links once per directory,
+ every page in a directory uses the same ones */
+void WriteNavLinks(Site* site, SiteTree& tree)
+{
+	ProfileScope scope("WriteNavLinks");
+
+	NavOptions nav = GetNavOptions(site);
+	tree.nav_files.clear();
+	tree.feed_links.clear();
+	if(nav.fragments)
+	{
+		NavFile file;
+		file.name = std::string("_nav") + PATH_SEPARATOR + "feed_links.html";
+		file.text = "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><base target=\"_top\"></head><body>";
+		WriteFeedLinks(tree, site, file.text);
+		file.text += "</body></html>\n";
+		tree.nav_files.push_back(std::move(file));
+		tree.feed_links = "<iframe class=\"nav-frame feed-links\" src=\"" + GetValue(site->data, SYMBOL_URL) + "/_nav/feed_links.html\"></iframe>";
+	}
+	else
+		WriteFeedLinks(tree, site, tree.feed_links);
+	for(unsigned dir = 0; dir < tree.nodes.size(); ++dir)
+	{
+		SiteNode& node = tree.nodes[dir];
+		if(!node.is_dir)
+			continue;
+		node.this_url = GetCurrentURL(GetValue(site->data, SYMBOL_URL), (std::filesystem::path(site->output_dir) / node.rel_dir / "index.html").string());
+		node.prev_links.clear();
+		node.next_links.clear();
+		node.page_links.clear();
+		WritePrevLinks(tree, dir, site, node.prev_links);
+		WriteNextLinks(tree, dir, site, nav, node.next_links);
+		WritePageLinks(tree, dir, site, nav, node.page_links);
+
+		// links are hashed once for keys of the render cache
+		node.nav_hash           = HashBytes(node.this_url.c_str(), node.this_url.size() + 1);
+		node.nav_hash           = HashBytes(node.prev_links.c_str(), node.prev_links.size() + 1, node.nav_hash);
+		node.listing_links_hash = HashBytes(node.next_links.c_str(), node.next_links.size() + 1);
+		node.listing_links_hash = HashBytes(node.page_links.c_str(), node.page_links.size() + 1, node.listing_links_hash);
+	}
+	tree.feed_links_hash = HashBytes(tree.feed_links.data(), tree.feed_links.size());
+}
+
+/* check if all needed folder and files are in right places */
+static bool CheckForDirsAndFiles(Site* site)
+{
+	ProfileScope scope("CheckForDirsAndFiles");
+
+	bool result = true;
+	auto is_dir = [&](std::string dir) {
+		if(!std::filesystem::is_directory(dir, error_code))
+		{
+			log_failure(dir << " is NOT a valid directory");
+			log_error_code;
+			result = false;
+		}
+	};
+	auto is_file = [&](std::string file_dir) {
+		if(!std::filesystem::is_regular_file(file_dir, error_code))
+		{
+			log_failure(file_dir << " is NOT a valid file directory");
+			log_error_code;
+			result = false;
+		}
+	};
+
+	is_dir(site->directory);
+	is_file(site->base_file_dir);
+	is_dir(site->feed_dir);
+	is_file(site->index_file_dir);
+	//is_dir(site->output_dir);
+	is_file(site->data_file_dir);
+
+	return result;
+}
+
+/* read keys and values of data/config site file (_data.txt/_config.txt)
+ and save values by symbols of their keys */
+static void ReadData(std::istream& file, SymbolTable& symbols, DataFile& data_file)
+{
+	std::string key;
+	std::string val;
+	while(file.peek() != EOF)
+	{
+		std::getline(file, key, ':');
+		std::getline(file, val);
+		unsigned symbol = InternSymbol(symbols, key);
+		if(symbol >= data_file.values.size())
+			data_file.values.resize(symbol + 1);
+		if(std::find(data_file.keys.begin(), data_file.keys.end(), symbol) == data_file.keys.end())
+			data_file.keys.push_back(symbol);
+		data_file.values[symbol] = val;
+	}
+}
+
+/* read data/config site file (_data.txt/_config.txt)
+ and save values by symbols of their keys */
+bool ReadDataFile(std::string file_dir, SymbolTable& symbols, DataFile& data_file)
+{
+	ProfileScope scope("ReadDataFile", file_dir);
+
+	std::ifstream file(file_dir);
+	if(file.is_open())
+	{
+		ReadData(file, symbols, data_file);
+		file.close();
+	}
+	else
+	{
+		log_failure(file_dir << " file is NOT open");
+		return false;
+	}
+
+	return true;
+}
+
+/* read manifest of the last build, return false if there is no valid one */
+static bool ReadManifest(std::string file_dir, Manifest& manifest)
+{
+	std::ifstream file(file_dir);
+	if(!file.is_open())
+		return false;
+
+	std::string header;
+	std::getline(file, header);
+	if(header != std::string("tim manifest ") + TIM_VERSION + " " MANIFEST_VERSION)
+		return false;
+
+	ManifestEntry entry;
+	std::string   name;
+	while(file >> entry.type >> std::hex >> entry.stamp >> entry.source_hash >> entry.flags >> entry.key)
+	{
+		file.get(); // a space before the name
+		std::getline(file, name);
+		manifest[name] = entry;
+	}
+	return true;
+}
+
+/* save manifest of the current build, it is written to a temporary file
+ and renamed so an interrupted build never leaves a broken manifest */
+static bool WriteManifest(std::string file_dir, const Manifest& manifest)
+{
+	ProfileScope scope("WriteManifest");
+
+	std::string temp_dir = file_dir + ".tmp";
+	{
+		std::ofstream file(temp_dir);
+		if(!file.is_open())
+			return false;
+		file << "tim manifest " << TIM_VERSION << " " MANIFEST_VERSION "\n"
+		     << std::hex;
+		std::vector<const Manifest::value_type*> sorted;
+		for(const auto& item : manifest)
+			sorted.push_back(&item);
+		std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) { return a->first < b->first; });
+		for(const auto* item : sorted)
+		{
+			const auto& [name, entry] = *item;
+			file << entry.type << ' ' << entry.stamp << ' ' << entry.source_hash << ' ' << entry.flags << ' ' << entry.key << ' ' << name << "\n";
+		}
+		if(!file)
+			return false;
+	}
+	std::filesystem::rename(temp_dir, file_dir, error_code);
+	log_error_code;
+	return error_code == std::error_code();
+}
+
+/* find given character in a file, the end if it is not there */
+static std::size_t FindChar(std::string_view file, char ch)
+{
+	// memchr of the C library compares many bytes at once
+	const char* found = (const char*)std::memchr(file.data(), ch, file.size());
+	return (found) ? (std::size_t)(found - file.data()) : (file.size());
+}
+
+/* take a part of a file up to given character, which is skipped too */
+static std::string_view TakeUntil(std::string_view& file, char ch)
+{
+	std::size_t      end  = FindChar(file, ch);
+	std::string_view part = file.substr(0, end);
+	file.remove_prefix((end < file.size()) ? (end + 1) : (end));
+	return part;
+}
+
+/* read data at the beginning of a file, what is left is the rest of the file,
+ and save keys with their symbols and values to given page data */
+static void ReadCurrFileData(std::string_view& file, const SymbolTable& symbols, PageData& data)
+{
+	data.size = 0;
+	while(file.size())
+	{
+		if(data.size == data.items.size())
+			data.items.emplace_back();
+		PageData::Item& item = data.items[data.size];
+		item.key             = TakeUntil(file, ':');
+		if(item.key == ";")
+			return;
+		item.value  = TakeUntil(file, '\n');
+		item.symbol = FindSymbol(symbols, std::string(item.key));
+		++data.size;
+	}
+}
+
+/* parse a file with '~' tokens into a template
+ the same way the file would be read token by token when generating a page,
+ names of data are bound to symbols and new ones are added only if add_symbols is set */
+static void CompileTemplate(std::string_view file, Template& tmpl, SymbolTable& symbols, bool add_symbols)
+{
+	while(file.size())
+	{
+		// literal text is not copied, it is a part of the file
+		std::size_t end = FindChar(file, '~');
+		if(end)
+		{
+			Token token;
+			token.literal = file.substr(0, end);
+			tmpl.tokens.push_back(token);
+		}
+		if(end == file.size())
+			break;
+		file.remove_prefix(end + 1);
+		while(file.size() && std::isspace((unsigned char)file[0]))
+			file.remove_prefix(1);
+		if(!file.size())
+			break;
+		char ch = file[0]; // take a chracter that indicates type of data
+		file.remove_prefix(1);
+		std::string str_data_to_replace(TakeUntil(file, '~')); // take a name and optionally arguments
+		std::string              str_file_name = str_data_to_replace; // a file to include may have dots in its name
+		std::vector<std::string> arguments     = SplitString(str_data_to_replace, '.');
+		str_data_to_replace                = (arguments.size()) ? (arguments[0]) : ("");
+
+		Token token;
+		token.type      = TokenType::UNDEFINED_TOKEN;
+		token.text      = str_data_to_replace;
+		token.arguments = arguments;
+		if(str_data_to_replace == "endif")
+			token.type = TokenType::ENDIF;
+		else
+		{
+			switch(ch)
+			{
+				// already defined data
+				case '_':
+				{
+					static const std::unordered_map<std::string, TokenType> defined = {
+					    {"content", TokenType::CONTENT},
+					    {"name", TokenType::NAME},
+					    {"url", TokenType::URL},
+					    {"this_url", TokenType::THIS_URL},
+					    {"title", TokenType::TITLE},
+					    {"prev_links", TokenType::PREV_LINKS},
+					    {"next_links", TokenType::NEXT_LINKS},
+					    {"feed_links", TokenType::FEED_LINKS},
+					    {"page_links", TokenType::PAGE_LINKS},
+					    {"if", TokenType::IF},
+					    {"ifnot", TokenType::IFNOT},
+					};
+					auto found = defined.find(str_data_to_replace);
+					token.type = (found != defined.end()) ? (found->second) : (TokenType::UNDEFINED_DATA);
+				}
+				break;
+
+				// a data defined in _data.txt
+				case ':': token.type = TokenType::SITE_DATA; break;
+
+				// a data defined in current content file
+				case '+': token.type = TokenType::PAGE_DATA; break;
+
+				// a file to include
+				case '=':
+					token.type = TokenType::INCLUDE;
+					token.text = str_file_name;
+					break;
+
+				default: token.text = std::string(1, ch); break;
+			}
+		}
+		if((token.type == TokenType::SITE_DATA) || (token.type == TokenType::PAGE_DATA))
+			token.symbol = (add_symbols) ? (InternSymbol(symbols, token.text)) : (FindSymbol(symbols, token.text));
+		tmpl.tokens.push_back(token);
+	}
+}
+
+/* read a whole text file at once, return false if it cannot be open */
+static bool ReadTextFile(std::string file_dir, std::string& str_data)
+{
+	std::ifstream file(file_dir);
+	if(!file.is_open())
+		return false;
+	str_data.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return true;
+}
+
+/* find the first whitespace character (or '<' in HTML) in given bytes */
+static const char* FindPackStop(const char* begin, const char* end, bool html)
+{
+#ifdef __SSE2__
+	const __m128i space = _mm_set1_epi8(' '), new_line = _mm_set1_epi8('\n'), tab = _mm_set1_epi8('\t'), carriage = _mm_set1_epi8('\r');
+	const __m128i tag   = _mm_set1_epi8(html ? '<' : ' ');
+	for(; end - begin >= 16; begin += 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*)begin);
+		__m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, new_line)),
+		                             _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, tab), _mm_cmpeq_epi8(chunk, carriage)), _mm_cmpeq_epi8(chunk, tag)));
+		int mask = _mm_movemask_epi8(found);
+		if(mask)
+			return begin + __builtin_ctz((unsigned)mask);
+	}
+#endif
+	for(; begin < end; ++begin)
+	{
+		char ch = *begin;
+		if((ch == ' ') || (ch == '\n') || (ch == '\t') || (ch == '\r') || (html && (ch == '<')))
+			return begin;
+	}
+	return end;
+}
+
+/* check if a character ends a name of an element */
+static bool IsTagNameEnd(char ch)
+{
+	return (ch == '>') || (ch == '/') || std::isspace((unsigned char)ch);
+}
+
+/* pack the next chunk of a file and append the result to output:
+ runs of whitespace become a single space (or a new line if keep_lines is set and the run has one),
+ in HTML elements <pre>, <textarea>, <script> and comments are copied as they are */
+static void PackChunk(Packer& packer, const char* data, std::size_t size, std::string& output)
+{
+	const char* end = data + size;
+	while(data < end)
+	{
+		switch(packer.state)
+		{
+			case PackState::TEXT:
+			{
+				const char* stop = FindPackStop(data, end, packer.html);
+				if(stop != data)
+				{
+					if(packer.space)
+						output += (packer.new_line) ? ('\n') : (' ');
+					packer.space = packer.new_line = false;
+					output.append(data, stop);
+					data = stop;
+					continue;
+				}
+				char ch = *data++;
+				if(ch == '<')
+				{
+					if(packer.space)
+						output += (packer.new_line) ? ('\n') : (' ');
+					packer.space = packer.new_line = false;
+					output += ch;
+					packer.tag.clear();
+					packer.state = PackState::TAG_NAME;
+				}
+				else
+				{
+					packer.space = true;
+					if((ch == '\n') && packer.keep_lines)
+						packer.new_line = true;
+				}
+			}
+			break;
+
+			// decide what to do with an element by its whole name,
+			// a name longer than any of raw elements is kept only up to one character more
+			case PackState::TAG_NAME:
+			{
+				char ch    = *data;
+				char lower = (char)std::tolower((unsigned char)ch);
+				if(std::isalnum((unsigned char)ch) || (ch == '!') || (ch == '-'))
+				{
+					if(packer.tag.size() <= 8)
+						packer.tag += lower;
+					output += ch;
+					++data;
+					if(packer.tag == "!--")
+					{
+						packer.matched = 0;
+						packer.state   = PackState::COMMENT;
+					}
+				}
+				else if(IsTagNameEnd(ch) && ((packer.tag == "pre") || (packer.tag == "textarea") || (packer.tag == "script")))
+				{
+					packer.end_tag = "</" + packer.tag;
+					packer.state   = PackState::RAW_TAG;
+				}
+				else
+					packer.state = PackState::TEXT;
+			}
+			break;
+
+			// attributes of an element whose content is copied as it is
+			case PackState::RAW_TAG:
+			{
+				const char* stop = (const char*)std::memchr(data, '>', end - data);
+				if(stop)
+				{
+					packer.matched = 0;
+					packer.state   = PackState::RAW;
+				}
+				stop = (stop) ? (stop + 1) : (end);
+				output.append(data, stop);
+				data = stop;
+			}
+			break;
+
+			// content of <pre>, <textarea> or <script> up to its closing tag
+			case PackState::RAW:
+			{
+				// the closing tag ends the content only if its name ends there too
+				if(packer.matched == packer.end_tag.size())
+				{
+					if(IsTagNameEnd(*data))
+					{
+						packer.state = PackState::TEXT;
+						break;
+					}
+					packer.matched = 0;
+				}
+				if(!packer.matched)
+				{
+					const char* stop = (const char*)std::memchr(data, '<', end - data);
+					stop             = (stop) ? (stop) : (end);
+					output.append(data, stop);
+					data = stop;
+					if(data == end)
+						break;
+				}
+				char ch = *data++;
+				output += ch;
+				if((char)std::tolower((unsigned char)ch) == packer.end_tag[packer.matched])
+					++packer.matched;
+				else
+					packer.matched = (ch == '<') ? (1) : (0);
+			}
+			break;
+
+			// a comment up to "-->"
+			case PackState::COMMENT:
+			{
+				char ch = *data++;
+				output += ch;
+				if(ch == '-')
+					++packer.matched;
+				else if((ch == '>') && (packer.matched >= 2))
+					packer.state = PackState::TEXT;
+				else
+					packer.matched = 0;
+			}
+			break;
+		}
+	}
+}
+
+/* get what listings, includes and values of the site and the page a template uses */
+static uint64_t GetListingFlags(const Template& tmpl)
+{
+	uint64_t flags = 0;
+	for(const Token& token : tmpl.tokens)
+	{
+		switch(token.type)
+		{
+			case TokenType::NEXT_LINKS:
+			case TokenType::PAGE_LINKS: flags |= USES_DIR_LISTING; break;
+			case TokenType::FEED_LINKS: flags |= USES_FEED_LISTING; break;
+			case TokenType::INCLUDE: flags |= USES_INCLUDES; break;
+			case TokenType::NAME: flags |= USES_NAME; break;
+			case TokenType::URL: flags |= USES_URL; break;
+			case TokenType::TITLE: flags |= USES_TITLE; break;
+			case TokenType::THIS_URL:
+			case TokenType::PREV_LINKS: flags |= USES_NAV; break;
+			case TokenType::IF:
+			case TokenType::IFNOT: flags |= USES_CONDITIONS; break;
+			default: break;
+		}
+	}
+	return flags;
+}
+
+/* find a file to include: next to the file that includes it or in _partials folder */
+static std::string FindInclude(Site* site, const std::string& dir, const std::string& name)
+{
+	std::string file_dir = dir + PATH_SEPARATOR + name;
+	if(std::filesystem::is_regular_file(file_dir, error_code))
+		return file_dir;
+	return site->directory + PATH_SEPARATOR + "_partials" + PATH_SEPARATOR + name;
+}
+
+static const Partial* GetPartial(Site* site, Partials& partials, const std::string& file_dir);
+
+/* get a file included by its name from given directory, it is found only once in a build,
+ file_dir is set to its path, nullptr if it includes itself */
+static const Partial* GetInclude(Site* site, Partials& partials, const std::string& dir, const std::string& name, const std::string*& file_dir)
+{
+	std::string key     = dir + '\n' + name;
+	Include*    include = nullptr;
+	{
+		std::shared_lock<std::shared_mutex> lock(partials.mutex);
+		auto                                found = partials.includes.find(key);
+		if(found != partials.includes.end())
+			include = &found->second;
+		if(include && include->partial)
+		{
+			file_dir = &include->file_dir;
+			return include->partial;
+		}
+	}
+	if(!include)
+	{
+		std::string                        path = FindInclude(site, dir, name);
+		std::lock_guard<std::shared_mutex> lock(partials.mutex);
+		include = &partials.includes.emplace(std::move(key), Include{std::move(path)}).first->second;
+	}
+
+	// a file including itself is not kept, it is nullptr only while it is being read
+	file_dir               = &include->file_dir;
+	const Partial* partial = GetPartial(site, partials, include->file_dir);
+	if(partial)
+	{
+		std::lock_guard<std::shared_mutex> lock(partials.mutex);
+		include->partial = partial;
+	}
+	return partial;
+}
+
+/* get a hash of files a template includes from given directory
+ and add listings they use to given flags, 0 if it includes nothing */
+static uint64_t GetIncludesHash(Site* site, Partials& partials, const Template& tmpl, const std::string& dir, uint64_t& flags)
+{
+	uint64_t hash = 0;
+	for(const Token& token : tmpl.tokens)
+	{
+		if(token.type != TokenType::INCLUDE)
+			continue;
+		const std::string* file_dir = nullptr;
+		const Partial*     partial  = GetInclude(site, partials, dir, token.text, file_dir);
+		hash                        = HashBytes(file_dir->c_str(), file_dir->size() + 1, (hash) ? (hash) : (HASH_SEED));
+		if(partial)
+		{
+			hash = HashCombine(hash, partial->hash);
+			flags |= partial->flags;
+		}
+	}
+	return hash;
+}
+
+/* get a file to include, it is read and compiled only the first time in a build,
+ nullptr if it includes itself */
+static const Partial* GetPartial(Site* site, Partials& partials, const std::string& file_dir)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(partials.mutex);
+		auto                                found = partials.files.find(file_dir);
+		if(found != partials.files.end())
+			return found->second.get();
+	}
+
+	// files being read on this thread, one of them included again includes itself
+	thread_local std::vector<std::string> reading;
+	if(std::find(reading.begin(), reading.end(), file_dir) != reading.end())
+		return nullptr;
+
+	std::unique_ptr<Partial> partial = std::make_unique<Partial>();
+	Template&                tmpl    = partial->tmpl;
+	partial->dir                     = std::filesystem::path(file_dir).parent_path().string();
+	partial->found                   = std::filesystem::is_regular_file(file_dir, error_code) && ReadTextFile(file_dir, tmpl.source);
+	partial->hash                    = HashCombine(HASH_SEED, partial->found);
+	if(partial->found)
+	{
+		tmpl.hash = HashBytes(tmpl.source.data(), tmpl.source.size());
+		CompileTemplate(tmpl.source, tmpl, *site->symbols, false);
+		partial->flags = GetListingFlags(tmpl);
+		partial->hash  = HashCombine(partial->hash, tmpl.hash);
+
+		// data from _data.txt is written into it, so its values are a part of it
+		for(const Token& token : tmpl.tokens)
+		{
+			if(token.type != TokenType::SITE_DATA)
+				continue;
+			const std::string& value = GetValue(site->data, token.symbol);
+			partial->hash            = HashBytes(token.text.c_str(), token.text.size() + 1, partial->hash);
+			partial->hash            = HashBytes(value.c_str(), value.size() + 1, partial->hash);
+		}
+
+		reading.push_back(file_dir);
+		partial->hash = HashCombine(partial->hash, GetIncludesHash(site, partials, tmpl, partial->dir, partial->flags));
+		reading.pop_back();
+	}
+
+	// another thread may have read the same file in the meantime
+	std::lock_guard<std::shared_mutex> lock(partials.mutex);
+	return partials.files.emplace(file_dir, std::move(partial)).first->second.get();
+}
+
+/* get a path relative to the output folder of a reference from given directory,
+ false if it goes out of the output folder */
+static bool JoinURLPath(const std::string& dir, std::string_view ref, std::string& path)
+{
+	std::vector<std::string_view> parts;
+	auto                          add = [&](std::string_view str) {
+		while(str.size())
+		{
+			std::size_t      end  = FindChar(str, '/');
+			std::string_view part = str.substr(0, end);
+			str.remove_prefix((end < str.size()) ? (end + 1) : (end));
+			if(part == "..")
+			{
+				if(!parts.size())
+					return false;
+				parts.pop_back();
+			}
+			else if(part.size() && (part != "."))
+				parts.push_back(part);
+		}
+		return true;
+	};
+	if(!add(dir) || !add(ref))
+		return false;
+	path.clear();
+	for(std::string_view part : parts)
+		path.append((path.size()) ? ("/") : ("")).append(part);
+	return true;
+}
+
+/* write text with references to fingerprinted assets (in href, src and CSS url) rewritten to their new names,
+ relative references are relative to given directory and absolute ones may begin with the URL of the site */
+static void RewriteReferences(std::string_view text, const SiteTree& tree, const std::string& dir, std::string_view url, std::string& output)
+{
+	while(url.size() && (url.back() == '/'))
+		url.remove_suffix(1);
+	std::size_t copied = 0, pos = 0;
+	std::string path;
+	while((pos = text.find_first_of("=(", pos)) != std::string_view::npos)
+	{
+		std::size_t start = pos + 1;
+		bool        css   = (text[pos] == '(');
+		bool        attr  = !css && (((pos >= 4) && (text.substr(pos - 4, 4) == "href")) || ((pos >= 3) && (text.substr(pos - 3, 3) == "src")));
+		pos               = start;
+		if(!attr && !(css && (start >= 4) && (text.substr(start - 4, 3) == "url")))
+			continue;
+
+		// a value in quotes or up to a space, '>' or ')'
+		while(css && (start < text.size()) && (text[start] == ' '))
+			++start;
+		char        quote = ((start < text.size()) && ((text[start] == '"') || (text[start] == '\''))) ? (text[start]) : (0);
+		std::size_t end   = (quote) ? (text.find(quote, ++start)) : (text.find_first_of((css) ? (")") : (" \t\r\n>"), start));
+		if(end == std::string_view::npos)
+			break;
+		pos = end;
+
+		std::string_view value  = text.substr(start, end - start);
+		std::string_view target = value.substr(0, std::min(value.find_first_of("?#"), value.size()));
+		bool             joined = false;
+		if(url.size() && (target.size() > url.size()) && (target.substr(0, url.size()) == url) && (target[url.size()] == '/'))
+			joined = JoinURLPath("", target.substr(url.size() + 1), path);
+		else if((target.substr(0, 2) == "//") || (target.find(':') < target.find('/')))
+			continue;
+		else if(target.substr(0, 1) == "/")
+			joined = JoinURLPath("", target.substr(1), path);
+		else
+			joined = JoinURLPath(dir, target, path);
+		auto found = (joined) ? (tree.fingerprints.find(path)) : (tree.fingerprints.end());
+		if(found == tree.fingerprints.end())
+			continue;
+
+		// only the name of a file changes
+		std::size_t name = target.rfind('/');
+		name             = (name == std::string_view::npos) ? (0) : (name + 1);
+		output.append(text.substr(copied, start + name - copied)).append(found->second);
+		copied = start + target.size();
+	}
+	output.append(text.substr(copied));
+}
+
+/* get a key of everything a render of the page reads, the same page of another build
+ or another site with the same key is the same file, so it can be taken from the render cache */
+static uint64_t GetRenderKey(const Template& base, const Template& content, const SiteTree& tree, const Page& page, Site* site, uint64_t content_hash, uint64_t includes_hash, uint64_t include_flags)
+{
+	uint64_t key = HashBytes(TIM_VERSION, std::strlen(TIM_VERSION));
+	key          = HashCombine(key, RENDER_CACHE_VERSION);
+	key          = HashCombine(key, base.hash);
+	key          = HashCombine(key, content_hash);
+	key          = HashCombine(key, includes_hash);
+	key          = HashCombine(key, tree.fingerprints_hash);
+
+	// values of the site and the page only if base, content or included files write them,
+	// so the same templates give the same key in every site
+	auto            hash_text = [&](const std::string& text) { key = HashBytes(text.c_str(), text.size() + 1, key); };
+	const SiteNode& dir       = tree.nodes[page.dir];
+	uint64_t        flags     = GetListingFlags(base) | GetListingFlags(content) | include_flags;
+	if(flags & USES_NAME)
+		hash_text(site->name);
+	if(flags & USES_TITLE)
+		hash_text(GetCurrentTitle(page.output_dir));
+	if(flags & USES_CONDITIONS)
+		key = HashCombine(key, page.content_dir == site->index_file_dir);
+
+	// references to fingerprinted assets are rewritten relative to the page or to the URL
+	if(tree.fingerprints.size())
+		hash_text(page.name);
+	if((flags & USES_URL) || tree.fingerprints.size())
+		hash_text(GetValue(site->data, SYMBOL_URL));
+	if(GetValue(site->config, SYMBOL_PACK_ON_BUILD) == "true")
+		hash_text(PREDEFINED_SYMBOL_NAMES[SYMBOL_PACK_ON_BUILD]);
+
+	// navigation and listings only if they are used
+	if(flags & USES_NAV)
+		key = HashCombine(key, dir.nav_hash);
+	if(flags & USES_DIR_LISTING)
+		key = HashCombine(key, dir.listing_links_hash);
+	if(flags & USES_FEED_LISTING)
+		key = HashCombine(key, tree.feed_links_hash);
+
+	// only values of _data.txt the page really uses
+	for(const Template* tmpl : {&base, &content})
+	{
+		for(const Token& token : tmpl->tokens)
+		{
+			if(token.type != TokenType::SITE_DATA)
+				continue;
+			hash_text(token.text);
+			hash_text(GetValue(site->data, token.symbol));
+		}
+	}
+	return key;
+}
+
+/* get a file of the render cache with given key */
+static std::string GetCacheFile(const std::string& cache_dir, uint64_t key)
+{
+	char name[20];
+	std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+	return cache_dir + PATH_SEPARATOR + std::string(name, 2) + PATH_SEPARATOR + (name + 2) + ".html";
+}
+
+/* put a generated page to the render cache,
+ it is written to a temporary file first and renamed then, so other builds never see half of it */
+static void StoreInCache(const std::string& cache_file, const std::string& page_file)
+{
+	thread_local uint64_t id = std::random_device()();
+	std::filesystem::create_directories(std::filesystem::path(cache_file).parent_path(), error_code);
+	std::string temp_file = cache_file + "." + std::to_string(id++) + ".tmp";
+	if(!CopyFeedFile(page_file, temp_file, "auto"))
+	{
+		log_verbose("Render cache file: " << temp_file << " was NOT written");
+		return;
+	}
+	std::filesystem::rename(temp_file, cache_file, error_code);
+	if(error_code != std::error_code())
+		std::filesystem::remove(temp_file, error_code);
+}
+
+/* remove .gz and .br files of a file of the output folder that is written again,
+ only if they were written by compressing it, they are compressed again by the next pack */
+static void DropCompressed(Site* site, const std::string& output_dir)
+{
+	std::lock_guard<std::mutex> lock(site->compressed_mutex);
+	if(!site->compressed.size() || !site->compressed.erase(output_dir.substr(site->output_dir.size() + 1)))
+		return;
+	std::filesystem::remove(output_dir + ".gz", error_code);
+	std::filesystem::remove(output_dir + ".br", error_code);
+	site->compressed_dropped = true;
+}
+
+/* write values of the site into a copy of the base template: tokens that give the same bytes on every page
+ (_name, _url, :key and _feed_links) become text merged with the text next to them,
+ so only tokens that depend on a page are evaluated for every page */
+void SpecializeBase(Site* site, SiteBuild& build)
+{
+	ProfileScope scope("SpecializeBase");
+
+	// text is gathered into the source first and literals point into it when it does not grow anymore
+	std::shared_ptr<Template>                        tmpl  = std::make_shared<Template>();
+	std::vector<std::pair<std::size_t, std::size_t>> texts;         // where text of a token begins in the source and the token
+	bool                                             merge = false; // the last token is text that can grow
+	tmpl->hash                                             = build.base->hash;
+	std::fill(std::begin(build.folded), std::end(build.folded), 0);
+	for(const Token& token : build.base->tokens)
+	{
+		std::string_view value;
+		bool             folded = true;
+		switch(token.type)
+		{
+			case TokenType::TEXT: value = token.literal; break;
+			case TokenType::NAME: value = site->name; break;
+			case TokenType::URL: value = GetValue(site->data, SYMBOL_URL); break;
+			case TokenType::FEED_LINKS: value = build.tree.feed_links; break;
+			case TokenType::SITE_DATA:
+				// undefined data is still reported by every page
+				value  = GetValue(site->data, token.symbol);
+				folded = value.size();
+				break;
+			default: folded = false; break;
+		}
+		if(!folded)
+		{
+			tmpl->tokens.push_back(token);
+			merge = false;
+			continue;
+		}
+		++build.folded[(std::size_t)token.type];
+		if(!value.size())
+			continue;
+		if(!merge)
+		{
+			texts.push_back({tmpl->source.size(), tmpl->tokens.size()});
+			tmpl->tokens.push_back(Token());
+			merge = true;
+		}
+		tmpl->source += value;
+	}
+	for(std::size_t i = 0; i < texts.size(); ++i)
+	{
+		std::size_t end                       = (i + 1 < texts.size()) ? (texts[i + 1].first) : (tmpl->source.size());
+		tmpl->tokens[texts[i].second].literal = std::string_view(tmpl->source).substr(texts[i].first, end - texts[i].first);
+	}
+	// text is still written, it is only merged into fewer tokens
+	unsigned& texts_folded = build.folded[(std::size_t)TokenType::TEXT];
+	texts_folded -= std::min(texts_folded, (unsigned)texts.size());
+
+	log_verbose("Tokens of _base.html: " << build.base->tokens.size() << ", left to evaluate for every page: " << tmpl->tokens.size());
+	build.page_base = std::move(tmpl);
+}
+
+/* generate a single final HTML file */
+bool GenerateHTMLFile(const SiteBuild& build, const Page& page, Site* site)
+{
+	ProfileScope scope("GenerateHTMLFile", page.name);
+
+	const Template&    base        = *build.base;
+	const Template&    page_base   = (build.page_base) ? (*build.page_base) : (base); // site values are written in once per scan
+	const SiteTree&    tree        = build.tree;
+	const std::string& output_dir  = page.output_dir;
+	const std::string& content_dir = page.content_dir;
+	const SiteNode&    dir         = tree.nodes[page.dir];
+	std::string        page_dir    = std::filesystem::path(content_dir).parent_path().string(); // includes are relative to it
+
+	bool write_value   = true;
+	bool content_wrote = false;
+
+	// content file is mapped, its data and literal text are parts of it and are never copied
+	thread_local PageData data;
+	MappedFile            content_file;
+	Template              content;
+	uint64_t              content_hash = 0;
+
+	{
+		ProfileScope read_scope("ReadContentFile");
+		if(MapFile(content_file, content_dir))
+		{
+			std::string_view content_data = content_file.data;
+			content_hash                  = HashBytes(content_data.data(), content_data.size());
+			ReadCurrFileData(content_data, *site->symbols, data);
+			CompileTemplate(content_data, content, *site->symbols, false);
+		}
+		else
+		{
+			log_failure("Content file: " << content_dir << " is NOT open");
+			return false;
+		}
+	}
+
+	// a page rendered before by any build of any site is only copied from the render cache
+	std::string cache_file;
+	if(site->cache_dir.size() && !page.rendered)
+	{
+		uint64_t include_flags = 0;
+		uint64_t includes_hash = HashCombine(GetIncludesHash(site, *build.partials, base, page_dir, include_flags),
+		                                     GetIncludesHash(site, *build.partials, content, page_dir, include_flags));
+		cache_file = GetCacheFile(site->cache_dir, GetRenderKey(base, content, tree, page, site, content_hash, includes_hash, include_flags));
+		uint64_t cached_size = std::filesystem::file_size(cache_file, error_code);
+		bool     in_cache    = (error_code == std::error_code());
+		if(in_cache && options.sync && HaveSameData(cache_file, output_dir))
+		{
+			++site->stats.cached;
+			++site->stats.unchanged;
+			return true;
+		}
+		if(in_cache && CopyFeedFile(cache_file, output_dir, GetValue(site->config, SYMBOL_COPY_MODE)))
+		{
+			DropCompressed(site, output_dir);
+			++site->stats.cached;
+			site->stats.bytes += cached_size;
+			return true;
+		}
+		// the old file may be a hardlink to the render cache, so it is never written over
+		if(!options.sync)
+			std::filesystem::remove(output_dir, error_code);
+	}
+
+	// with --sync the page is compared with the file already there while it is generated,
+	// it is written to a temporary file that replaces the old one only from the first different byte,
+	// so a page that has not changed never touches its file
+	MappedFile  old_file;
+	bool        same        = options.sync && !page.rendered && MapFile(old_file, output_dir);
+	std::string write_dir   = (options.sync) ? (output_dir + ".tmp") : (output_dir);
+	OutputFile  output_file;
+	auto        open_output = [&]() {
+		DropCompressed(site, output_dir);
+		if(OpenOutputFile(output_file, write_dir))
+			return true;
+		log_failure("File: " << write_dir << " is NOT open");
+		return false;
+	};
+	if(!page.rendered && !same && !open_output())
+		return false;
+
+	// a page is put together in a buffer reused by all pages generated on the same thread
+	// and written to its file in chunks, so even a page bigger than memory can be generated
+	thread_local std::string output;
+	output.clear();
+	std::size_t written = 0;
+	bool        failed  = false;
+	auto        differ  = [&]() {
+		same = false;
+		if(!open_output() || !WriteOutputFile(output_file, old_file.data.substr(0, written)))
+			failed = true;
+	};
+	auto flush = [&](std::string_view text) {
+		if(same && (old_file.data.substr(written, text.size()) == text))
+		{
+			written += text.size();
+			return;
+		}
+		if(same)
+			differ();
+		if(page.rendered)
+			page.rendered->append(text);
+		else if(!failed && !WriteOutputFile(output_file, text))
+			failed = true;
+		written += text.size();
+	};
+
+	// references to fingerprinted assets are rewritten just before the buffer is written,
+	// only up to its last '>', so a reference is never split between two writes
+	thread_local std::string rewritten;
+	bool                     rewrite      = tree.fingerprints.size();
+	std::string              page_url_dir = std::filesystem::path(page.name).parent_path().generic_string();
+	auto                     flush_output = [&](bool all) {
+		if(!rewrite)
+		{
+			flush(output);
+			output.clear();
+			return;
+		}
+		std::size_t end = (all) ? (output.size()) : (output.rfind('>') + 1);
+		rewritten.clear();
+		RewriteReferences(std::string_view(output).substr(0, end), tree, page_url_dir, GetValue(site->data, SYMBOL_URL), rewritten);
+		flush(rewritten);
+		output.erase(0, end);
+	};
+
+	// with pack_on_build in _config.txt a page is packed before it is written
+	Packer packer;
+	bool   pack     = (GetValue(site->config, SYMBOL_PACK_ON_BUILD) == "true");
+	packer.html     = true;
+	auto write_text = [&](std::string_view text) {
+		if(pack)
+			PackChunk(packer, text.data(), text.size(), output);
+		else if(!rewrite && (text.size() >= PAGE_FLUSH_SIZE))
+		{
+			// a long text goes straight to the file
+			flush(output);
+			output.clear();
+			flush(text);
+			return;
+		}
+		else
+			output += text;
+		if(output.size() >= PAGE_FLUSH_SIZE)
+			flush_output(false);
+	};
+
+	// with --profile time of every token is measured, content and included files are measured by their own tokens
+	uint64_t token_time[TOKEN_TYPES]  = {};
+	uint64_t token_count[TOKEN_TYPES] = {};
+
+	// files being included, includes of the last one are relative to its directory
+	std::vector<const Partial*> including;
+
+	std::function<void(const Template&)>
+	    write = [&](const Template& tmpl) {
+		for(const Token& token : tmpl.tokens)
+		{
+			if(token.type == TokenType::ENDIF)
+			{
+				write_value = true;
+				continue;
+			}
+			if(!write_value)
+				continue;
+
+			std::chrono::steady_clock::time_point token_begin;
+			if(options.profile)
+				token_begin = std::chrono::steady_clock::now();
+
+			switch(token.type)
+			{
+				case TokenType::TEXT: write_text(token.literal); break;
+				case TokenType::CONTENT:
+					// content is written only once, also when it includes ~_content~ itself
+					if(!content_wrote)
+					{
+						content_wrote = true;
+						write(content);
+					}
+					break;
+				case TokenType::NAME: write_text(site->name); break;
+				case TokenType::URL: write_text(GetValue(site->data, SYMBOL_URL)); break;
+				case TokenType::THIS_URL: write_text(dir.this_url); break;
+				case TokenType::TITLE: write_text(GetCurrentTitle(output_dir)); break;
+				case TokenType::PREV_LINKS: write_text(dir.prev_links); break;
+				case TokenType::NEXT_LINKS: write_text(dir.next_links); break;
+				case TokenType::FEED_LINKS: write_text(tree.feed_links); break;
+				case TokenType::PAGE_LINKS: write_text(dir.page_links); break;
+				case TokenType::IF:
+				case TokenType::IFNOT:
+				{
+					bool neg    = (token.type == TokenType::IFNOT);
+					write_value = neg;
+					if((token.arguments.size() == 3) && (token.arguments[1] == "page"))
+					{
+						if((token.arguments[2] == "site_index") && (content_dir == site->index_file_dir)) write_value = !neg;
+					}
+				}
+				break;
+				case TokenType::SITE_DATA:
+				{
+					const std::string& value = GetValue(site->data, token.symbol);
+					if(value.size())
+						write_text(value);
+					else
+						log_failure("Undefined data to replace: " << token.text);
+				}
+				break;
+				case TokenType::PAGE_DATA:
+				{
+					std::string_view value = GetValue(data, token);
+					if(value.size())
+						write_text(value);
+					else
+						log_failure("Undefined data to replace: " << token.text);
+				}
+				break;
+				case TokenType::INCLUDE:
+				{
+					const std::string& include_dir = (including.size()) ? (including.back()->dir) : (page_dir);
+					const std::string* file_dir    = nullptr;
+					const Partial*     partial     = GetInclude(site, *build.partials, include_dir, token.text, file_dir);
+					if(partial && !partial->found)
+						log_failure("A file to include: " << *file_dir << " is NOT open");
+					else if(!partial || (std::find(including.begin(), including.end(), partial) != including.end()))
+						log_failure("A file to include: " << *file_dir << " includes itself");
+					else
+					{
+						including.push_back(partial);
+						write(partial->tmpl);
+						including.pop_back();
+					}
+				}
+				break;
+				case TokenType::UNDEFINED_DATA: log_failure("Undefined data to replace: " << token.text); break;
+				case TokenType::UNDEFINED_TOKEN: log_failure("Undefined token: " << token.text); break;
+				case TokenType::ENDIF: break;
+			}
+
+			if(options.profile)
+			{
+				if((token.type != TokenType::CONTENT) && (token.type != TokenType::INCLUDE))
+					token_time[(std::size_t)token.type] += GetNanoseconds(token_begin, std::chrono::steady_clock::now());
+				++token_count[(std::size_t)token.type];
+			}
+		}
+	};
+
+	write(page_base);
+
+	if(options.profile)
+	{
+		std::lock_guard<std::mutex> lock(profile.mutex);
+		for(std::size_t type = 0; type < TOKEN_TYPES; ++type)
+		{
+			if(build.page_base)
+				profile.token_folded[type] += build.folded[type];
+			profile.token_time[type] += token_time[type];
+			profile.token_count[type] += token_count[type];
+		}
+	}
+
+	flush_output(true);
+	bool result    = true;
+	bool unchanged = !page.rendered && same && (written == old_file.data.size());
+	if(page.rendered)
+		result = !failed;
+	else if(unchanged)
+		++site->stats.unchanged;
+	else
+	{
+		if(same)
+			differ();
+		result = CloseOutputFile(output_file) && !failed;
+		if(options.sync)
+		{
+			if(result)
+				std::filesystem::rename(write_dir, output_dir, error_code);
+			if(!result || (error_code != std::error_code()))
+			{
+				std::filesystem::remove(write_dir, error_code);
+				result = false;
+			}
+		}
+	}
+	if(result)
+	{
+		// a page that has not changed is not counted as generated, like an asset that is not copied
+		if(!unchanged)
+		{
+			++site->stats.pages;
+			site->stats.bytes += written;
+		}
+		if(cache_file.size())
+			StoreInCache(cache_file, output_dir);
+	}
+	else
+		log_failure("File: " << output_dir << " is NOT written");
+
+	// a buffer grown by a very big page is not kept for the next ones
+	if(output.capacity() > PAGE_BUFFER_LIMIT)
+		std::string().swap(output);
+	if(rewritten.capacity() > PAGE_BUFFER_LIMIT)
+		std::string().swap(rewritten);
+
+	return result;
+}
+
+/* get what listings content uses without compiling it,
+ it may give more than is really used but never less */
+void GetDataListingFlags(std::string_view str_data, uint64_t& flags, uint64_t& hash)
+{
+	hash  = HashBytes(str_data.data(), str_data.size());
+	flags = 0;
+	if((str_data.find("_next_links") != std::string_view::npos) || (str_data.find("_page_links") != std::string_view::npos))
+		flags |= USES_DIR_LISTING;
+	if(str_data.find("_feed_links") != std::string_view::npos)
+		flags |= USES_FEED_LISTING;
+	for(std::size_t tilde = str_data.find('~'); tilde != std::string_view::npos; tilde = str_data.find('~', tilde + 1))
+	{
+		std::size_t type = str_data.find_first_not_of(" \t\r\n\v\f", tilde + 1);
+		if((type != std::string_view::npos) && (str_data[type] == '='))
+		{
+			flags |= USES_INCLUDES;
+			break;
+		}
+	}
+}
+
+/* get what listings a content file uses without compiling it */
+static bool GetContentListingFlags(std::string file_dir, uint64_t& flags, uint64_t& hash)
+{
+	MappedFile file;
+	if(!MapFile(file, file_dir))
+		return false;
+	GetDataListingFlags(file.data, flags, hash);
+	return true;
+}
+
+/* get a hash of files a page includes and add listings they use to given flags */
+static uint64_t GetPageIncludesHash(Site* site, const SiteBuild& build, const std::string& content_dir, uint64_t content_flags, uint64_t& flags)
+{
+	std::string page_dir = std::filesystem::path(content_dir).parent_path().string();
+	uint64_t    hash     = GetIncludesHash(site, *build.partials, *build.base, page_dir, flags);
+	if(content_flags & USES_INCLUDES)
+	{
+		// the content is compiled only to find what it includes
+		MappedFile file;
+		if(MapFile(file, content_dir))
+		{
+			std::string_view content_data = file.data;
+			PageData         data;
+			Template         content;
+			ReadCurrFileData(content_data, *site->symbols, data);
+			CompileTemplate(content_data, content, *site->symbols, false);
+			hash = HashCombine(hash, GetIncludesHash(site, *build.partials, content, page_dir, flags));
+		}
+	}
+	return hash;
+}
+
+/* get a key of all inputs a page is generated from */
+static uint64_t GetPageKey(const SiteTree& tree, const SiteNode& node, uint64_t flags, uint64_t inputs_hash, uint64_t source_hash, uint64_t includes_hash)
+{
+	uint64_t key = HashCombine(inputs_hash, source_hash);
+	if(includes_hash)
+		key = HashCombine(key, includes_hash);
+	if(tree.fingerprints_hash)
+		key = HashCombine(key, tree.fingerprints_hash);
+
+	// listings as they are written into pages, with nav_mode:fragment they are only frames
+	// that change when a listing gets its first node or loses its last one
+	if(flags & USES_DIR_LISTING)
+		key = HashCombine(key, tree.nodes[node.parent].listing_links_hash);
+	if(flags & USES_FEED_LISTING)
+		key = HashCombine(key, tree.feed_links_hash);
+	return key;
+}
+
+/* copy a file of _feed folder to the output folder, or write it with its references rewritten */
+static void CopyAsset(Site* site, const SiteNode& node, const std::string& content_dir, const std::string& output_dir)
+{
+	if(options.sync && ((node.is_rewritten) ? (HasFileData(output_dir, node.rewritten)) : (HaveSameData(content_dir, output_dir))))
+	{
+		++site->stats.unchanged;
+		return;
+	}
+
+	DropCompressed(site, output_dir);
+	bool copied = false;
+	if(node.is_rewritten)
+	{
+		// the old file may be a hardlink to the file in _feed folder, so it is never written over
+		std::filesystem::remove(output_dir, error_code);
+		copied = WriteFile(output_dir, node.rewritten);
+	}
+	else
+		copied = CopyFeedFile(content_dir, output_dir, GetValue(site->config, SYMBOL_COPY_MODE));
+	if(copied)
+	{
+		++site->stats.assets;
+		site->stats.bytes += std::filesystem::file_size(output_dir, error_code);
+	}
+	else
+		log_failure(content_dir << " file was NOT copied");
+}
+
+/* give assets with extensions from fingerprint in _config.txt names with hashes of their content,
+ the same for the same content, so they can be cached forever, and write them to _fingerprints.json:
+ files are hashed in parallel, CSS files after them, as references in them are rewritten first */
+static bool FingerprintAssets(Site* site, SiteBuild& build)
+{
+	ProfileScope scope("FingerprintAssets");
+
+	SiteTree&                tree       = build.tree;
+	std::vector<std::string> extensions = SplitString(GetValue(site->config, SYMBOL_FINGERPRINT), ',');
+	tree.fingerprints.clear();
+	tree.fingerprints_hash = 0;
+	if(!extensions.size())
+	{
+		std::filesystem::remove(site->fingerprints_file_dir, error_code);
+		return true;
+	}
+
+	std::vector<unsigned> files, css_files;
+	for(unsigned index = 1; index < tree.nodes.size(); ++index)
+	{
+		const SiteNode& node      = tree.nodes[index];
+		std::string     extension = std::filesystem::path(node.name).extension().string();
+		if(node.is_dir || node.is_html || (std::find(extensions.begin(), extensions.end(), extension) == extensions.end()))
+			continue;
+		((extension == ".css") ? (css_files) : (files)).push_back(index);
+	}
+
+	// a file with the same stamp as in the last build has the same hash,
+	// this may run on a thread of sites built together, so failures are logged in the order of files
+	std::vector<char> hashed;
+	bool              result = RunParallelLogged(
+	    files.size(), [&](std::size_t i) -> bool {
+		    SiteNode& node  = tree.nodes[files[i]];
+		    auto      found = build.manifest.find(node.rel_dir);
+		    if((found != build.manifest.end()) && (found->second.type == 'f') && (found->second.stamp == node.stamp) && found->second.source_hash)
+		    {
+			    node.content_hash = found->second.source_hash;
+			    return true;
+		    }
+		    MappedFile file;
+		    if(!MapFile(file, site->feed_dir + PATH_SEPARATOR + node.rel_dir))
+		    {
+			    log_failure("File: " << node.rel_dir << " is NOT open");
+			    return false;
+		    }
+		    node.content_hash = HashBytes(file.data.data(), file.data.size());
+		    return true;
+	    },
+	    hashed);
+
+	auto get_path = [](std::string path) {
+		std::replace(path.begin(), path.end(), '\\', '/');
+		return path;
+	};
+	auto add_fingerprint = [&](SiteNode& node) {
+		char hash[12];
+		std::snprintf(hash, sizeof(hash), ".%08llx", (unsigned long long)(node.content_hash >> 32));
+		std::filesystem::path name(node.name);
+		node.fingerprint = name.stem().string() + hash + name.extension().string();
+
+		std::string path        = get_path(node.rel_dir);
+		std::size_t dir         = path.rfind('/');
+		tree.fingerprints[path] = node.fingerprint;
+		tree.fingerprints_hash  = HashCombine(HashBytes(path.c_str(), path.size() + 1, tree.fingerprints_hash), node.content_hash);
+		return path.substr(0, (dir == std::string::npos) ? (0) : (dir + 1)) + node.fingerprint;
+	};
+	std::string json = "{";
+	auto        add_json = [&](const SiteNode& node, const std::string& fingerprint) {
+		json += (json.size() > 1) ? (",\n\t") : ("\n\t");
+		WriteJSONString(json, get_path(node.rel_dir));
+		json += ": ";
+		WriteJSONString(json, fingerprint);
+	};
+	for(unsigned index : files)
+		if(tree.nodes[index].content_hash)
+			add_json(tree.nodes[index], add_fingerprint(tree.nodes[index]));
+
+	// CSS files are hashed with their references rewritten, so they change when files they use change
+	std::string url = GetValue(site->data, SYMBOL_URL);
+	for(unsigned index : css_files)
+	{
+		SiteNode&  node = tree.nodes[index];
+		MappedFile file;
+		if(!MapFile(file, site->feed_dir + PATH_SEPARATOR + node.rel_dir))
+		{
+			log_failure("File: " << node.rel_dir << " is NOT open");
+			result = false;
+			continue;
+		}
+		node.rewritten.clear();
+		RewriteReferences(file.data, tree, std::filesystem::path(node.rel_dir).parent_path().generic_string(), url, node.rewritten);
+		node.is_rewritten = true;
+		node.content_hash = HashBytes(node.rewritten.data(), node.rewritten.size());
+		add_json(node, add_fingerprint(node));
+	}
+	json += "\n}\n";
+
+	if(!WriteFile(site->fingerprints_file_dir, json))
+	{
+		log_failure(site->fingerprints_file_dir << " file was NOT written");
+		return false;
+	}
+	log_line("Assets fingerprinted: " << tree.fingerprints.size());
+	return result;
+}
+
+/* get how files of a site are compressed from _config.txt */
+static CompressOptions GetCompressOptions(Site* site)
+{
+	CompressOptions          compress;
+	std::vector<std::string> formats = SplitString(GetValue(site->config, SYMBOL_COMPRESS), ',');
+	compress.gzip                    = (std::find(formats.begin(), formats.end(), "gzip") != formats.end());
+	compress.brotli                  = (std::find(formats.begin(), formats.end(), "brotli") != formats.end());
+
+	auto get_number = [&](unsigned symbol, unsigned& value, unsigned max) {
+		const std::string& str = GetValue(site->config, symbol);
+		if(str.size() && ParseUnsigned(str, value))
+			value = std::min(value, max);
+	};
+	get_number(SYMBOL_COMPRESS_MIN_SIZE, compress.min_size, ~0u);
+	get_number(SYMBOL_GZIP_LEVEL, compress.gzip_level, 9);
+	get_number(SYMBOL_BROTLI_LEVEL, compress.brotli_level, 11);
+
+	// settings are a part of hashes, so files are compressed again when they change
+	compress.settings = HashCombine(HashCombine(HashCombine(HashCombine(HASH_SEED, compress.gzip), compress.brotli), compress.gzip_level), compress.brotli_level);
+	return compress;
+}
+
+/* bring the output folder up to date with _feed folder:
+ directories are created, other files copied only when they have changed,
+ files and directories that are no longer in _feed are removed
+ and pages whose inputs have changed are collected to be generated */
+static bool UpdateOutput(Site* site, const SiteBuild& build, Manifest& next, std::vector<Page>& pages)
+{
+	ProfileScope scope("UpdateOutput");
+
+	const SiteTree& tree       = build.tree;
+	const Manifest& last       = build.manifest;
+	uint64_t        base_flags = GetListingFlags(*build.base);
+	unsigned copied_files  = 0;
+	unsigned removed_files = 0;
+
+	// content files that have changed are read before the walk, all at once with --io-uring,
+	// every node knows which of them is its file
+	constexpr std::size_t      NOT_CHANGED = ~(std::size_t)0;
+	std::vector<std::string>   changed_files;
+	std::vector<std::size_t>   changed_index(tree.nodes.size(), NOT_CHANGED);
+	std::vector<ManifestEntry> changed;
+	std::vector<char>          read;
+	for(unsigned index = 1; index < tree.nodes.size(); ++index)
+	{
+		const SiteNode& node  = tree.nodes[index];
+		auto            found = last.find(node.rel_dir);
+		if(!node.is_html || ((found != last.end()) && (found->second.type == 'p') && (found->second.stamp == node.stamp)))
+			continue;
+		changed_index[index] = changed_files.size();
+		changed_files.push_back(site->feed_dir + PATH_SEPARATOR + node.rel_dir);
+	}
+	changed.resize(changed_files.size());
+	ReadFiles(
+	    changed_files, [&](std::size_t i, std::string_view data) { GetDataListingFlags(data, changed[i].flags, changed[i].source_hash); }, read);
+
+	for(unsigned index = 1; index < tree.nodes.size(); ++index)
+	{
+		const SiteNode& node        = tree.nodes[index];
+		std::string     output_dir  = site->output_dir + PATH_SEPARATOR + node.rel_dir;
+		std::string     content_dir = site->feed_dir + PATH_SEPARATOR + node.rel_dir;
+		auto            found       = last.find(node.rel_dir);
+		bool            exists      = std::filesystem::exists(output_dir, error_code);
+
+		ManifestEntry entry;
+		entry.stamp = node.stamp;
+		if(node.is_dir)
+		{
+			entry.type = 'd';
+			if(!exists && !std::filesystem::create_directory(output_dir, error_code))
+			{
+				log_failure(output_dir << " directory was NOT created");
+				log_error_code;
+				return false;
+			}
+		}
+		else if(node.is_html)
+		{
+			entry.type    = 'p';
+			std::size_t i = changed_index[index];
+			if(i == NOT_CHANGED)
+			{
+				entry.source_hash = found->second.source_hash;
+				entry.flags       = found->second.flags;
+			}
+			else if(!read[i])
+			{
+				log_failure("Content file: " << content_dir << " is NOT open");
+				return false;
+			}
+			else
+			{
+				entry.source_hash = changed[i].source_hash;
+				entry.flags       = changed[i].flags;
+			}
+
+			uint64_t flags         = base_flags | entry.flags;
+			uint64_t includes_hash = (flags & USES_INCLUDES) ? (GetPageIncludesHash(site, build, content_dir, entry.flags, flags)) : (0);
+			entry.key              = GetPageKey(tree, node, flags, build.inputs_hash, entry.source_hash, includes_hash);
+			if(!exists || (found == last.end()) || (found->second.key != entry.key))
+				pages.push_back({output_dir, content_dir, node.rel_dir, node.parent});
+		}
+		else
+		{
+			entry.type = 'f';
+			entry.key  = entry.stamp;
+			if(node.fingerprint.size())
+			{
+				entry.source_hash = node.content_hash;
+				entry.key         = HashCombine(entry.stamp, node.content_hash);
+			}
+			if(!exists || (found == last.end()) || (found->second.key != entry.key))
+			{
+				CopyAsset(site, node, content_dir, output_dir);
+				++copied_files;
+			}
+			log_verbose("Omittet file in generating: " << output_dir);
+
+			// a fingerprinted copy is kept next to the file, so references that are not rewritten still work
+			if(node.fingerprint.size())
+			{
+				std::string rel_dir = (std::filesystem::path(node.rel_dir).parent_path() / node.fingerprint).string();
+				std::string file    = site->output_dir + PATH_SEPARATOR + rel_dir;
+				auto        last_fp = last.find(rel_dir);
+				if((last_fp == last.end()) || (last_fp->second.key != entry.key) || !std::filesystem::exists(file, error_code))
+				{
+					CopyAsset(site, node, content_dir, file);
+					++copied_files;
+				}
+				next[rel_dir]      = entry;
+				next[rel_dir].type = 'a';
+			}
+		}
+		next[node.rel_dir] = entry;
+	}
+
+	// files with navigation links are written only when their links have changed
+	for(const NavFile& file : tree.nav_files)
+	{
+		std::string output_dir = site->output_dir + PATH_SEPARATOR + file.name;
+		std::string nav_dir    = std::filesystem::path(file.name).parent_path().string();
+		next[nav_dir].type     = 'd';
+
+		ManifestEntry entry;
+		entry.type = 'n';
+		entry.key  = HashBytes(file.text.data(), file.text.size());
+		auto found = last.find(file.name);
+		if((found == last.end()) || (found->second.key != entry.key) || !std::filesystem::exists(output_dir, error_code))
+		{
+			std::filesystem::create_directories(site->output_dir + PATH_SEPARATOR + nav_dir, error_code);
+			if(options.sync && HasFileData(output_dir, file.text))
+				++site->stats.unchanged;
+			else if(WriteFile(output_dir, file.text))
+			{
+				DropCompressed(site, output_dir);
+				site->stats.bytes += file.text.size();
+			}
+			else
+			{
+				log_failure("File: " << output_dir << " is NOT written");
+				continue;
+			}
+		}
+		next[file.name] = entry;
+	}
+
+	for(const auto& [name, entry] : last)
+	{
+		if(next.find(name) == next.end())
+		{
+			std::filesystem::remove_all(site->output_dir + PATH_SEPARATOR + name, error_code);
+			log_error_code;
+			++removed_files;
+		}
+	}
+
+	// with --sync any other file in the output folder is removed too, even without a manifest,
+	// .gz and .br files that are not copied from _feed folder are kept only if they were written by compressing
+	// and their sources have the same bytes now, pages written again later drop them too
+	if(options.sync)
+	{
+		uint64_t                              settings = GetCompressOptions(site).settings;
+		std::unordered_map<std::string, bool> fresh; // by sources, both .gz and .br of a file are checked once
+		auto                                  is_fresh = [&](const std::string& source) {
+			auto checked = fresh.find(source);
+			if(checked != fresh.end())
+				return checked->second;
+			auto       found = site->compressed.find(source);
+			MappedFile file;
+			bool       same  = (found != site->compressed.end()) && (next.find(source) != next.end()) && MapFile(file, site->output_dir + PATH_SEPARATOR + source);
+			same             = same && (HashCombine(HashBytes(file.data.data(), file.data.size()), settings) == found->second);
+			if(!same && (found != site->compressed.end()))
+			{
+				site->compressed.erase(found);
+				site->compressed_dropped = true;
+			}
+			return fresh[source] = same;
+		};
+		std::vector<std::filesystem::path> orphans;
+		for(auto entry = std::filesystem::recursive_directory_iterator(site->output_dir, error_code); entry != std::filesystem::recursive_directory_iterator(); entry.increment(error_code))
+		{
+			std::string rel_dir   = std::filesystem::relative(entry->path(), site->output_dir, error_code).string();
+			std::string extension = entry->path().extension().string();
+			if(next.find(rel_dir) != next.end())
+				continue;
+			if(((extension == ".gz") || (extension == ".br")) && is_fresh(rel_dir.substr(0, rel_dir.size() - extension.size())))
+				continue;
+			orphans.push_back(entry->path());
+			if(entry->is_directory(error_code))
+				entry.disable_recursion_pending();
+		}
+		for(const std::filesystem::path& file : orphans)
+		{
+			std::filesystem::remove_all(file, error_code);
+			log_error_code;
+			++removed_files;
+		}
+	}
+
+	log_line("Files copied: " << copied_files << ", removed: " << removed_files);
+	return true;
+}
+
+/* generate given HTML final site files in output folder */
+static bool GenerateFiles(Site* site, const SiteBuild& build, const std::vector<Page>& pages, std::vector<char>& generated)
+{
+	ProfileScope scope("GenerateFiles");
+
+	return RunParallelLogged(
+	    pages.size(), [&](std::size_t i) -> bool {
+		    if(GenerateHTMLFile(build, pages[i], site))
+			    return true;
+		    log_failure("File: " << pages[i].output_dir << " was NOT generated");
+		    return false;
+	    },
+	    generated);
+}
+
+/* pack a single file: it is read and packed in chunks into a temporary file
+ which then replaces the original one */
+static bool PackFile(std::string file_dir, Stats& stats)
+{
+	ProfileScope scope("PackFile", file_dir);
+
+	std::ifstream input(file_dir, std::ios::binary);
+	if(!input.is_open())
+	{
+		log_failure(file_dir << " input file is NOT open");
+		return false;
+	}
+
+	std::string   temp_dir = file_dir + ".tmp";
+	std::ofstream output(temp_dir, std::ios::binary);
+	if(!output.is_open())
+	{
+		log_failure(file_dir << " output file is NOT open");
+		return false;
+	}
+
+	std::string extension = std::filesystem::path(file_dir).extension().string();
+	Packer      packer;
+	packer.html       = (extension == ".html") || (extension == ".htm");
+	packer.keep_lines = (extension == ".js");
+
+	std::vector<char> buffer(PACK_CHUNK_SIZE);
+	std::string       packed;
+	uint64_t          packed_size = 0;
+	while(input.read(buffer.data(), buffer.size()) || input.gcount())
+	{
+		PackChunk(packer, buffer.data(), (std::size_t)input.gcount(), packed);
+		output.write(packed.data(), packed.size());
+		packed_size += packed.size();
+		packed.clear();
+	}
+	input.close();
+	output.close();
+	if(!output)
+	{
+		log_failure(file_dir << " output file was NOT written");
+		std::filesystem::remove(temp_dir, error_code);
+		return false;
+	}
+
+	std::filesystem::rename(temp_dir, file_dir, error_code);
+	log_error_code;
+	if(error_code != std::error_code())
+		return false;
+	++stats.packed;
+	stats.bytes += packed_size;
+	return true;
+}
+
+/* compress given bytes with gzip into a file */
+static bool WriteGzipFile(std::string file_dir, std::string_view data, unsigned level)
+{
+#ifdef TIM_WITH_ZLIB
+	z_stream stream = {};
+	if(deflateInit2(&stream, (int)level, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+		return false;
+	OutputFile file;
+	if(!OpenOutputFile(file, file_dir))
+	{
+		deflateEnd(&stream);
+		return false;
+	}
+
+	// input is given in chunks as zlib counts bytes in 32 bits
+	std::vector<unsigned char> buffer(PACK_CHUNK_SIZE);
+	bool                       written = true;
+	int                        flush   = Z_NO_FLUSH;
+	std::size_t                offset  = 0;
+	while(flush != Z_FINISH)
+	{
+		std::size_t size = std::min<std::size_t>(data.size() - offset, PACK_CHUNK_SIZE);
+		stream.next_in   = (Bytef*)(data.data() + offset);
+		stream.avail_in  = (uInt)size;
+		offset += size;
+		flush = (offset == data.size()) ? (Z_FINISH) : (Z_NO_FLUSH);
+		do
+		{
+			stream.next_out  = buffer.data();
+			stream.avail_out = (uInt)buffer.size();
+			deflate(&stream, flush);
+			written = WriteOutputFile(file, std::string_view((const char*)buffer.data(), buffer.size() - stream.avail_out)) && written;
+		} while(!stream.avail_out);
+	}
+	deflateEnd(&stream);
+	return CloseOutputFile(file) && written;
+#else
+	(void)file_dir, (void)data, (void)level;
+	return false;
+#endif
+}
+
+/* compress given bytes with brotli into a file */
+static bool WriteBrotliFile(std::string file_dir, std::string_view data, unsigned level)
+{
+#ifdef TIM_WITH_BROTLI
+	BrotliEncoderState* state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+	if(!state)
+		return false;
+	BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, level);
+	BrotliEncoderSetParameter(state, BROTLI_PARAM_SIZE_HINT, (uint32_t)std::min<std::size_t>(data.size(), UINT32_MAX));
+	OutputFile file;
+	if(!OpenOutputFile(file, file_dir))
+	{
+		BrotliEncoderDestroyInstance(state);
+		return false;
+	}
+
+	std::vector<uint8_t> buffer(PACK_CHUNK_SIZE);
+	bool                 written  = true;
+	std::size_t          avail_in = data.size();
+	const uint8_t*       next_in  = (const uint8_t*)data.data();
+	while(written && !BrotliEncoderIsFinished(state))
+	{
+		std::size_t avail_out = buffer.size();
+		uint8_t*    next_out  = buffer.data();
+		if(!BrotliEncoderCompressStream(state, BROTLI_OPERATION_FINISH, &avail_in, &next_in, &avail_out, &next_out, nullptr))
+			written = false;
+		else
+			written = WriteOutputFile(file, std::string_view((const char*)buffer.data(), buffer.size() - avail_out));
+	}
+	BrotliEncoderDestroyInstance(state);
+	return CloseOutputFile(file) && written;
+#else
+	(void)file_dir, (void)data, (void)level;
+	return false;
+#endif
+}
+
+/* append a number to bytes of a zip archive, least significant byte first */
+static void AppendLittleEndian(std::string& output, uint64_t value, unsigned bytes)
+{
+	for(unsigned i = 0; i < bytes; ++i)
+		output += (char)((value >> (8 * i)) & 0xff);
+}
+
+/* open a file for an archive with a format given by its extension: .tar, .tar.gz, .tgz or .zip,
+ '-' writes a tar to stdout */
+static bool OpenArchive(Archive& archive, const std::string& file_dir)
+{
+	auto ends_with = [&](const std::string& end) { return (file_dir.size() >= end.size()) && (file_dir.compare(file_dir.size() - end.size(), end.size(), end) == 0); };
+	archive.format = (ends_with(".zip")) ? ('z') : ((ends_with(".tar.gz") || ends_with(".tgz")) ? ('g') : ('t'));
+#ifndef TIM_WITH_ZLIB
+	if(archive.format != 't')
+	{
+		log_failure("Archive: " << file_dir << " can NOT be written, the app was built without zlib");
+		return false;
+	}
+#endif
+
+	// entries get the same time in every build if $SOURCE_DATE_EPOCH is set
+	const char* epoch = std::getenv("SOURCE_DATE_EPOCH");
+	archive.mtime     = (epoch) ? (std::strtoull(epoch, nullptr, 10)) : ((uint64_t)std::time(nullptr));
+	std::time_t time  = (std::time_t)archive.mtime;
+	std::tm*    date  = std::gmtime(&time);
+	if(date && (date->tm_year >= 80))
+		archive.dos_time = ((uint32_t)(date->tm_year - 80) << 25) | ((uint32_t)(date->tm_mon + 1) << 21) | ((uint32_t)date->tm_mday << 16) |
+		                   ((uint32_t)date->tm_hour << 11) | ((uint32_t)date->tm_min << 5) | ((uint32_t)date->tm_sec / 2);
+	else
+		archive.dos_time = (1 << 21) | (1 << 16); // 1980-01-01
+
+	if(file_dir == "-")
+	{
+#ifdef __linux__
+		archive.file.fd = STDOUT_FILENO;
+#else
+		log_failure("Writing an archive to stdout is possible only on Linux");
+		return false;
+#endif
+	}
+	else if(!OpenOutputFile(archive.file, file_dir))
+		return false;
+#ifdef TIM_WITH_ZLIB
+	if((archive.format == 'g') && (deflateInit2(&archive.stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK))
+	{
+		CloseOutputFile(archive.file);
+		return false;
+	}
+#endif
+	return true;
+}
+
+#ifdef TIM_WITH_ZLIB
+/* compress what was given to the gzip stream of a tar.gz archive and write it */
+static void DeflateArchive(Archive& archive, int flush)
+{
+	archive.buffer.resize(PACK_CHUNK_SIZE);
+	do
+	{
+		archive.stream.next_out  = (Bytef*)&archive.buffer[0];
+		archive.stream.avail_out = (uInt)archive.buffer.size();
+		deflate(&archive.stream, flush);
+		std::string_view output(archive.buffer.data(), archive.buffer.size() - archive.stream.avail_out);
+		if(!archive.failed && !WriteOutputFile(archive.file, output))
+			archive.failed = true;
+	} while(!archive.stream.avail_out);
+}
+#endif
+
+/* write bytes to an archive, through gzip for tar.gz */
+static void WriteArchive(Archive& archive, std::string_view data)
+{
+	archive.offset += data.size();
+#ifdef TIM_WITH_ZLIB
+	if(archive.format == 'g')
+	{
+		// input is given in chunks as zlib counts bytes in 32 bits
+		for(std::size_t offset = 0; offset < data.size(); offset += PACK_CHUNK_SIZE)
+		{
+			archive.stream.next_in  = (Bytef*)(data.data() + offset);
+			archive.stream.avail_in = (uInt)std::min<std::size_t>(data.size() - offset, PACK_CHUNK_SIZE);
+			DeflateArchive(archive, Z_NO_FLUSH);
+		}
+		return;
+	}
+#endif
+	if(!archive.failed && !WriteOutputFile(archive.file, data))
+		archive.failed = true;
+}
+
+/* write a header of a tar entry, a name too long for ustar is given in a pax header before it */
+static void WriteTarHeader(Archive& archive, const std::string& name, char type, uint64_t size)
+{
+	std::string_view path = name, prefix;
+	if(name.size() > 100)
+	{
+		std::size_t split = name.find('/', name.size() - 101);
+		if((split != std::string::npos) && (split <= 155) && (split + 1 < name.size()))
+		{
+			prefix = path.substr(0, split);
+			path   = path.substr(split + 1);
+		}
+		else
+		{
+			// a record is its length in digits, which is a part of the length itself, and the name
+			std::string record = " path=" + name + "\n";
+			std::size_t length = record.size() + 1;
+			while(std::to_string(length).size() + record.size() != length)
+				++length;
+			record = std::to_string(length) + record;
+			WriteTarHeader(archive, "PaxHeader", 'x', record.size());
+			WriteArchive(archive, record);
+			WriteArchive(archive, std::string((512 - record.size() % 512) % 512, '\0'));
+			path = path.substr(path.size() - 100);
+		}
+	}
+
+	char header[512] = {};
+	std::memcpy(header, path.data(), path.size());
+	std::memcpy(header + 100, (type == '5') ? ("0000755") : ("0000644"), 8);
+	std::memcpy(header + 108, "0000000", 8);
+	std::memcpy(header + 116, "0000000", 8);
+	std::snprintf(header + 124, 12, "%011llo", (unsigned long long)size);
+	std::snprintf(header + 136, 12, "%011llo", (unsigned long long)archive.mtime);
+	std::memset(header + 148, ' ', 8);
+	header[156] = type;
+	std::memcpy(header + 257, "ustar", 6);
+	std::memcpy(header + 263, "00", 2);
+	std::memcpy(header + 345, prefix.data(), prefix.size());
+	unsigned checksum = 0;
+	for(unsigned char c : header)
+		checksum += c;
+	std::snprintf(header + 148, 8, "%06o", checksum);
+	WriteArchive(archive, std::string_view(header, sizeof(header)));
+}
+
+/* add a file, or a directory if its name ends with '/', to an archive */
+static void AddArchiveFile(Archive& archive, const std::string& name, std::string_view data)
+{
+	bool is_dir = (name.back() == '/');
+	if(archive.format != 'z')
+	{
+		if(data.size() >= (1ull << 33))
+		{
+			log_failure("File: " << name << " is too big for a tar archive");
+			archive.failed = true;
+			return;
+		}
+		WriteTarHeader(archive, name, (is_dir) ? ('5') : ('0'), data.size());
+		WriteArchive(archive, data);
+		WriteArchive(archive, std::string((512 - data.size() % 512) % 512, '\0'));
+		return;
+	}
+
+#ifdef TIM_WITH_ZLIB
+	// without zip64 sizes and offsets have 32 bits
+	if((data.size() >= 0xffffffffu) || (archive.offset >= 0xffffffffu) || (archive.entries.size() >= 0xffff))
+	{
+		log_failure("File: " << name << " does NOT fit in a zip archive, a tar archive has no limits");
+		archive.failed = true;
+		return;
+	}
+	ZipEntry entry;
+	entry.name            = name;
+	entry.size            = (uint32_t)data.size();
+	entry.compressed_size = entry.size;
+	entry.offset          = (uint32_t)archive.offset;
+	entry.crc             = (uint32_t)crc32_z(crc32(0, nullptr, 0), (const Bytef*)data.data(), data.size());
+
+	// a file is deflated only if it gets smaller
+	z_stream stream = {};
+	if(data.size() && (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK))
+	{
+		archive.buffer.resize(deflateBound(&stream, (uLong)data.size()));
+		stream.next_in   = (Bytef*)data.data();
+		stream.avail_in  = (uInt)data.size();
+		stream.next_out  = (Bytef*)&archive.buffer[0];
+		stream.avail_out = (uInt)archive.buffer.size();
+		if((deflate(&stream, Z_FINISH) == Z_STREAM_END) && (stream.total_out < data.size()))
+		{
+			entry.method          = 8;
+			entry.compressed_size = (uint32_t)stream.total_out;
+		}
+		deflateEnd(&stream);
+	}
+
+	std::string header;
+	AppendLittleEndian(header, 0x04034b50, 4);
+	AppendLittleEndian(header, 20, 2);     // version needed to extract
+	AppendLittleEndian(header, 0x0800, 2); // names are in UTF-8
+	AppendLittleEndian(header, entry.method, 2);
+	AppendLittleEndian(header, archive.dos_time, 4);
+	AppendLittleEndian(header, entry.crc, 4);
+	AppendLittleEndian(header, entry.compressed_size, 4);
+	AppendLittleEndian(header, entry.size, 4);
+	AppendLittleEndian(header, name.size(), 2);
+	AppendLittleEndian(header, 0, 2);
+	header += name;
+	WriteArchive(archive, header);
+	WriteArchive(archive, (entry.method) ? (std::string_view(archive.buffer.data(), entry.compressed_size)) : (data));
+	archive.entries.push_back(std::move(entry));
+#endif
+}
+
+/* finish an archive: the end of a tar or the central directory of a zip */
+static bool CloseArchive(Archive& archive)
+{
+	if(archive.format != 'z')
+		WriteArchive(archive, std::string(1024, '\0'));
+	else
+	{
+		std::string directory;
+		for(const ZipEntry& entry : archive.entries)
+		{
+			bool is_dir = (entry.name.back() == '/');
+			AppendLittleEndian(directory, 0x02014b50, 4);
+			AppendLittleEndian(directory, (3 << 8) | 20, 2); // made on unix
+			AppendLittleEndian(directory, 20, 2);
+			AppendLittleEndian(directory, 0x0800, 2);
+			AppendLittleEndian(directory, entry.method, 2);
+			AppendLittleEndian(directory, archive.dos_time, 4);
+			AppendLittleEndian(directory, entry.crc, 4);
+			AppendLittleEndian(directory, entry.compressed_size, 4);
+			AppendLittleEndian(directory, entry.size, 4);
+			AppendLittleEndian(directory, entry.name.size(), 2);
+			AppendLittleEndian(directory, 0, 6); // lengths of extra field and comment, disk number
+			AppendLittleEndian(directory, 0, 2); // internal attributes
+			AppendLittleEndian(directory, (is_dir) ? ((040755u << 16) | 0x10) : (0100644u << 16), 4);
+			AppendLittleEndian(directory, entry.offset, 4);
+			directory += entry.name;
+		}
+		std::size_t size = directory.size();
+		AppendLittleEndian(directory, 0x06054b50, 4);
+		AppendLittleEndian(directory, 0, 4); // disk numbers
+		AppendLittleEndian(directory, archive.entries.size(), 2);
+		AppendLittleEndian(directory, archive.entries.size(), 2);
+		AppendLittleEndian(directory, size, 4);
+		AppendLittleEndian(directory, archive.offset, 4);
+		AppendLittleEndian(directory, 0, 2);
+		WriteArchive(archive, directory);
+	}
+#ifdef TIM_WITH_ZLIB
+	if(archive.format == 'g')
+	{
+		DeflateArchive(archive, Z_FINISH);
+		deflateEnd(&archive.stream);
+	}
+#endif
+	return CloseOutputFile(archive.file) && !archive.failed;
+}
+
+/* read hashes of files whose compressed files are up to date */
+static void ReadCompressedList(std::string file_dir, std::unordered_map<std::string, uint64_t>& compressed)
+{
+	compressed.clear();
+	std::ifstream file(file_dir);
+	std::string   header;
+	if(!std::getline(file, header) || (header != std::string("tim compressed ") + TIM_VERSION))
+		return;
+	uint64_t    hash;
+	std::string name;
+	while(file >> std::hex >> hash)
+	{
+		file.get(); // a space before the name
+		std::getline(file, name);
+		compressed[name] = hash;
+	}
+}
+
+/* save hashes of files whose compressed files are up to date,
+ it is written to a temporary file and renamed like the manifest */
+static bool WriteCompressedList(std::string file_dir, const std::vector<std::pair<std::string, uint64_t>>& compressed)
+{
+	std::string temp_dir = file_dir + ".tmp";
+	{
+		std::ofstream file(temp_dir);
+		if(!file.is_open())
+			return false;
+		file << "tim compressed " << TIM_VERSION << "\n"
+		     << std::hex;
+		for(const auto& [name, hash] : compressed)
+			file << hash << ' ' << name << "\n";
+		if(!file)
+			return false;
+	}
+	std::filesystem::rename(temp_dir, file_dir, error_code);
+	log_error_code;
+	return error_code == std::error_code();
+}
+
+/* write _compressed.txt again if files in it were written again by a build */
+static void WriteDroppedCompressed(Site* site)
+{
+	if(!site->compressed_dropped)
+		return;
+	site->compressed_dropped = false;
+	std::vector<std::pair<std::string, uint64_t>> list(site->compressed.begin(), site->compressed.end());
+	std::sort(list.begin(), list.end());
+	if(!WriteCompressedList(site->compressed_file_dir, list))
+		log_failure(site->compressed_file_dir << " file was NOT written");
+}
+
+/* read _data.txt, _config.txt and _base.html again,
+ files with the same content as ones in the cache are taken from it */
+bool LoadSiteInputs(Site* site, SiteBuild& build, InputCache& cache)
+{
+	ProfileScope scope("LoadSiteInputs");
+
+	std::string str_data;
+	auto        load_data = [&](const std::string& file_dir, DataFile& data_file, uint64_t& hash) {
+		if(!ReadTextFile(file_dir, str_data))
+			return false;
+		hash       = HashBytes(str_data.data(), str_data.size());
+		auto found = cache.data_files.find(hash);
+		if(found == cache.data_files.end())
+		{
+			std::istringstream stream(str_data);
+			DataFile           parsed;
+			ReadData(stream, *site->symbols, parsed);
+			found = cache.data_files.emplace(hash, std::move(parsed)).first;
+		}
+		data_file = found->second;
+		return true;
+	};
+
+	uint64_t base_hash = 0, data_hash = 0, config_hash = 0;
+	if(!load_data(site->data_file_dir, site->data, data_hash))
+	{
+		log_failure(site->name << " site data file was NOT read");
+		return false;
+	}
+
+	if(!load_data(site->config_file_dir, site->config, config_hash))
+	{
+		log_failure(site->name << " site config file was NOT read");
+		return false;
+	}
+
+	// base file is the same for every page so it is parsed only once,
+	// symbols are shared by all sites so its template can be used by other sites too
+	if(!ReadTextFile(site->base_file_dir, str_data))
+	{
+		log_failure("Base site file is NOT open");
+		return false;
+	}
+	base_hash  = HashBytes(str_data.data(), str_data.size());
+	auto found = cache.templates.find(base_hash);
+	if(found == cache.templates.end())
+	{
+		std::shared_ptr<Template> base = std::make_shared<Template>();
+		base->source                   = str_data;
+		base->hash                     = base_hash;
+		CompileTemplate(base->source, *base, *site->symbols, true);
+		found = cache.templates.emplace(base_hash, std::move(base)).first;
+	}
+	build.base = found->second;
+
+	// render cache from --cache or cache_dir in _config.txt, relative to the site folder
+	site->cache_dir = options.cache_dir;
+	const std::string& cache_dir = GetValue(site->config, SYMBOL_CACHE_DIR);
+	if(!site->cache_dir.size() && cache_dir.size())
+	{
+		std::filesystem::path cache_path(cache_dir);
+		site->cache_dir = (cache_path.is_absolute()) ? (cache_dir) : (site->directory + PATH_SEPARATOR + cache_dir);
+	}
+
+	// inputs shared by all pages
+	build.inputs_hash = HashCombine(HashCombine(HashCombine(HASH_SEED, base_hash), data_hash), config_hash);
+	return true;
+}
+
+/* scan _feed folder and get everything pages share from it */
+static void ScanSite(Site* site, SiteBuild& build)
+{
+	// _feed folder is scanned once and navigation links are the same for all pages in a directory
+	ScanFeed(site, build.tree);
+	WriteNavLinks(site, build.tree);
+
+	// included files are read again, any of them may have changed
+	build.partials = std::make_shared<Partials>();
+
+	if(!FingerprintAssets(site, build))
+		log_failure("Assets were NOT fingerprinted");
+
+	// _feed_links are known only now
+	SpecializeBase(site, build);
+}
+
+/* scan _feed folder, bring the output folder up to date
+ and collect pages whose inputs have changed since the last build */
+static bool CollectPages(Site* site, SiteBuild& build, Manifest& next, std::vector<Page>& pages)
+{
+	ScanSite(site, build);
+	ReadCompressedList(site->compressed_file_dir, site->compressed);
+	if(!UpdateOutput(site, build, next, pages))
+	{
+		log_failure("Output folder was NOT updated");
+		return false;
+	}
+	std::sort(pages.begin(), pages.end(), [](const Page& a, const Page& b) { return a.output_dir < b.output_dir; });
+	log_line("Pages to generate: " << pages.size());
+	return true;
+}
+
+/* keep the manifest of a finished build and write it */
+static void FinishBuild(Site* site, SiteBuild& build, Manifest& next, const std::vector<Page>& pages, const char* generated)
+{
+	// pages that were NOT generated are forgotten so they are generated next time
+	for(std::size_t i = 0; i < pages.size(); ++i)
+		if(!generated[i])
+			next.erase(pages[i].name);
+	build.manifest = std::move(next);
+	if(!WriteManifest(site->manifest_file_dir, build.manifest))
+		log_failure(site->manifest_file_dir << " manifest file was NOT written");
+	WriteDroppedCompressed(site);
+}
+
+/* scan _feed folder and generate pages whose inputs have changed since the last build */
+static bool UpdateSite(Site* site, SiteBuild& build)
+{
+	Manifest          next;
+	std::vector<Page> pages;
+	if(!CollectPages(site, build, next, pages))
+		return false;
+
+	std::vector<char> generated;
+	bool              result = GenerateFiles(site, build, pages, generated);
+	FinishBuild(site, build, next, pages, generated.data());
+
+	if(!result)
+	{
+		log_failure("Generating files was NOT successful");
+		return false;
+	}
+	return true;
+}
+
+/* generate a page or copy a file again after its content has changed,
+ return false if the file is not known so _feed folder has to be scanned */
+static bool UpdateFeedFile(Site* site, SiteBuild& build, std::string rel_dir, bool& result)
+{
+	auto found = build.tree.paths.find(rel_dir);
+	if(found == build.tree.paths.end())
+		return false;
+	SiteNode& node = build.tree.nodes[found->second];
+	if(node.is_dir)
+		return true;
+
+	// a new fingerprint changes references in other files
+	if(node.fingerprint.size())
+		return false;
+
+	std::string content_dir = site->feed_dir + PATH_SEPARATOR + rel_dir;
+	std::string output_dir  = site->output_dir + PATH_SEPARATOR + rel_dir;
+	node.stamp              = GetFileStamp(std::filesystem::directory_entry(content_dir, error_code));
+
+	ManifestEntry entry;
+	entry.stamp = node.stamp;
+	if(node.is_html)
+	{
+		entry.type = 'p';
+		if(!GetContentListingFlags(content_dir, entry.flags, entry.source_hash))
+			return false;
+		uint64_t flags         = GetListingFlags(*build.base) | entry.flags;
+		uint64_t includes_hash = (flags & USES_INCLUDES) ? (GetPageIncludesHash(site, build, content_dir, entry.flags, flags)) : (0);
+		entry.key              = GetPageKey(build.tree, node, flags, build.inputs_hash, entry.source_hash, includes_hash);
+
+		// saving a file without changing it does not need a new page
+		auto last = build.manifest.find(rel_dir);
+		if((last != build.manifest.end()) && (last->second.key == entry.key))
+		{
+			last->second = entry;
+			return true;
+		}
+
+		std::vector<Page> pages = {{output_dir, content_dir, rel_dir, node.parent}};
+		std::vector<char> generated;
+		result = GenerateFiles(site, build, pages, generated) && result;
+		if(!generated[0])
+		{
+			build.manifest.erase(rel_dir);
+			return true;
+		}
+	}
+	else
+	{
+		entry.type = 'f';
+		entry.key  = entry.stamp;
+		CopyAsset(site, node, content_dir, output_dir);
+	}
+	build.manifest[rel_dir] = entry;
+	return true;
+}
+
+/* put a site into an archive instead of its output folder: files are added in the order of their names,
+ so the same site always gives the same archive, pages are rendered in parallel in batches before they are added */
+static bool ArchiveSite(Site* site, SiteBuild& build, Archive& archive)
+{
+	ProfileScope scope("ArchiveSite");
+
+	ScanSite(site, build);
+	const SiteTree& tree = build.tree;
+	std::string     root = std::filesystem::path(site->output_dir).filename().generic_string() + "/";
+
+	// every directory comes right before its children
+	std::vector<unsigned> order, stack = {0};
+	while(stack.size())
+	{
+		unsigned index = stack.back();
+		stack.pop_back();
+		order.push_back(index);
+		stack.insert(stack.end(), tree.nodes[index].children.rbegin(), tree.nodes[index].children.rend());
+	}
+
+	bool                     result = true;
+	std::vector<Page>        pages;
+	std::vector<std::string> rendered;
+	std::vector<char>        generated;
+	for(std::size_t begin = 0; begin < order.size(); begin += ARCHIVE_BATCH_SIZE)
+	{
+		std::size_t end = std::min(order.size(), begin + ARCHIVE_BATCH_SIZE);
+		pages.clear();
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			const SiteNode& node = tree.nodes[order[i]];
+			if(node.is_html)
+				pages.push_back({site->output_dir + PATH_SEPARATOR + node.rel_dir, site->feed_dir + PATH_SEPARATOR + node.rel_dir, node.rel_dir, node.parent});
+		}
+		rendered.assign(pages.size(), std::string());
+		for(std::size_t i = 0; i < pages.size(); ++i)
+			pages[i].rendered = &rendered[i];
+		result = GenerateFiles(site, build, pages, generated) && result;
+
+		std::size_t page = 0;
+		for(std::size_t i = begin; i < end; ++i)
+		{
+			const SiteNode& node = tree.nodes[order[i]];
+			std::string     name = root + std::filesystem::path(node.rel_dir).generic_string();
+			if(node.is_dir)
+				AddArchiveFile(archive, (node.rel_dir.size()) ? (name + "/") : (root), std::string_view());
+			else if(node.is_html)
+			{
+				if(generated[page])
+					AddArchiveFile(archive, name, rendered[page]);
+				++page;
+			}
+			else
+			{
+				MappedFile       file;
+				std::string_view data = node.rewritten;
+				if(!node.is_rewritten && !MapFile(file, site->feed_dir + PATH_SEPARATOR + node.rel_dir))
+				{
+					log_failure(site->feed_dir + PATH_SEPARATOR + node.rel_dir << " file was NOT read");
+					result = false;
+					continue;
+				}
+				if(!node.is_rewritten)
+					data = file.data;
+				AddArchiveFile(archive, name, data);
+				if(node.fingerprint.size())
+					AddArchiveFile(archive, name.substr(0, name.rfind('/') + 1) + node.fingerprint, data);
+				++site->stats.assets;
+				site->stats.bytes += data.size();
+			}
+		}
+	}
+
+	// files with navigation links are in _nav folders of their directories
+	std::string nav_dir;
+	for(const NavFile& file : tree.nav_files)
+	{
+		std::string name = root + std::filesystem::path(file.name).generic_string();
+		if(name.compare(0, name.rfind('/') + 1, nav_dir) != 0)
+		{
+			nav_dir = name.substr(0, name.rfind('/') + 1);
+			AddArchiveFile(archive, nav_dir, std::string_view());
+		}
+		AddArchiveFile(archive, name, file.text);
+		site->stats.bytes += file.text.size();
+	}
+	return result && !archive.failed;
+}
+
+/* get a type of a file sent by serve task from its extension */
+static const char* GetContentType(const std::string& extension)
+{
+	static const std::unordered_map<std::string, const char*> types = {
+	    {".html", "text/html; charset=utf-8"}, {".css", "text/css; charset=utf-8"}, {".js", "text/javascript; charset=utf-8"},
+	    {".json", "application/json"}, {".txt", "text/plain; charset=utf-8"}, {".xml", "application/xml"}, {".svg", "image/svg+xml"},
+	    {".png", "image/png"}, {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"}, {".gif", "image/gif"}, {".webp", "image/webp"},
+	    {".ico", "image/x-icon"}, {".woff", "font/woff"}, {".woff2", "font/woff2"}, {".pdf", "application/pdf"}};
+	auto found = types.find(extension);
+	return (found != types.end()) ? (found->second) : ("application/octet-stream");
+}
+
+/* decode '%' followed by two hex digits in a path of a URL, false if the path is not valid */
+static bool DecodeURL(std::string_view url, std::string& decoded)
+{
+	decoded.clear();
+	for(std::size_t i = 0; i < url.size(); ++i)
+	{
+		if(url[i] != '%')
+		{
+			decoded += url[i];
+			continue;
+		}
+		if((i + 2 >= url.size()) || !std::isxdigit((unsigned char)url[i + 1]) || !std::isxdigit((unsigned char)url[i + 2]))
+			return false;
+		char c = (char)std::stoi(std::string(url.substr(i + 1, 2)), nullptr, 16);
+		if(!c)
+			return false;
+		decoded += c;
+		i += 2;
+	}
+	return true;
+}
+
+// > HELPFUL FUNCTIONS
+/////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////
+// < SITE-TASKS
+
+/* create a new site folder and copy an example one */
+static bool NewSite(Site* site)
+{
+	if(std::filesystem::is_directory(site->directory, error_code))
+	{
+		log_failure("Site with this name already exists");
+		log_error_code;
+		return false;
+	}
+
+	if(!(std::filesystem::create_directory(site->directory, error_code)))
+	{
+		log_failure(site->directory << " directory was NOT created");
+		log_error_code;
+		return false;
+	}
+
+	std::filesystem::copy(std::filesystem::current_path(error_code).string() + PATH_SEPARATOR + EXAMPLE_FOLDER, site->directory,
+	                      std::filesystem::copy_options::overwrite_existing | std::filesystem::copy_options::recursive, error_code);
+	log_error_code;
+
+	return true;
+}
+
+/* check folders of a site before it is built and read the manifest of its last build,
+ without a manifest the output folder is built again from nothing */
+static bool PrepareBuild(Site* site, SiteBuild& build)
+{
+	if(!CheckForDirsAndFiles(site))
+	{
+		log_failure("Some needed directories and files are NOT valid");
+		return false;
+	}
+
+	// without a manifest of the last build it is not known what is up to date
+	if(options.full || !std::filesystem::is_directory(site->output_dir, error_code) || !ReadManifest(site->manifest_file_dir, build.manifest))
+	{
+		// with --sync files already there are compared with new ones and kept if they are the same
+		build.manifest.clear();
+		if(options.sync && std::filesystem::is_directory(site->output_dir, error_code))
+			return true;
+		std::filesystem::remove_all(site->output_dir, error_code);
+		log_error_code;
+		if(!std::filesystem::create_directory(site->output_dir, error_code))
+		{
+			log_error_code;
+			return false;
+		}
+	}
+	return true;
+}
+
+/* write .gz and .br files next to files of the output folder with extensions from to_pack
+ as given by compress, compress_min_size, gzip_level and brotli_level in _config.txt,
+ files that have not changed since they were compressed are skipped */
+static bool CompressSite(Site* site)
+{
+	ProfileScope scope("CompressSite");
+
+	CompressOptions compress = GetCompressOptions(site);
+	bool            gzip     = compress.gzip;
+	bool            brotli   = compress.brotli;
+	if(!gzip && !brotli)
+		return true;
+#ifndef TIM_WITH_ZLIB
+	if(gzip)
+	{
+		log_failure("Compressing with gzip is NOT possible, the app was built without zlib");
+		return false;
+	}
+#endif
+#ifndef TIM_WITH_BROTLI
+	if(brotli)
+	{
+		log_failure("Compressing with brotli is NOT possible, the app was built without brotli");
+		return false;
+	}
+#endif
+
+	std::unordered_map<std::string, uint64_t> last;
+	ReadCompressedList(site->compressed_file_dir, last);
+
+	// compressed files whose sources are gone or are not compressed anymore are removed,
+	// only if they were written by compressing, other .gz and .br files are copied from _feed folder
+	std::vector<std::string> files, orphans;
+	std::vector<std::string> to_pack = SplitString(GetValue(site->config, SYMBOL_TO_PACK), ',');
+	for(const auto& entry : std::filesystem::recursive_directory_iterator(site->output_dir, error_code))
+	{
+		log_error_code;
+		if(!entry.is_regular_file(error_code))
+			continue;
+		std::string extension = entry.path().extension().string();
+		std::string rel_dir   = entry.path().string().substr(site->output_dir.size() + 1);
+		if((extension == ".gz") || (extension == ".br"))
+		{
+			std::string source = rel_dir.substr(0, rel_dir.size() - extension.size());
+			bool        packed = (std::find(to_pack.begin(), to_pack.end(), std::filesystem::path(source).extension().string()) != to_pack.end());
+			if(last.count(source) && (!packed || !std::filesystem::exists(site->output_dir + PATH_SEPARATOR + source, error_code)))
+				orphans.push_back(entry.path().string());
+		}
+		else if(std::find(to_pack.begin(), to_pack.end(), extension) != to_pack.end())
+			files.push_back(rel_dir);
+	}
+	for(const std::string& orphan : orphans)
+		std::filesystem::remove(orphan, error_code);
+	std::sort(files.begin(), files.end());
+
+	std::vector<uint64_t> hashes(files.size(), 0);
+	std::vector<char>     compressed;
+	bool                  result = RunParallelLogged(
+	    files.size(), [&](std::size_t i) -> bool {
+		    ProfileScope scope("CompressFile", files[i]);
+
+		    std::string file_dir = site->output_dir + PATH_SEPARATOR + files[i];
+		    MappedFile  file;
+		    if(!MapFile(file, file_dir))
+		    {
+			    log_failure(file_dir << " input file is NOT open");
+			    return false;
+		    }
+
+		    // a small file is sent faster as it is
+		    if(file.data.size() < compress.min_size)
+		    {
+			    std::filesystem::remove(file_dir + ".gz", error_code);
+			    std::filesystem::remove(file_dir + ".br", error_code);
+			    return true;
+		    }
+
+		    uint64_t hash  = HashCombine(HashBytes(file.data.data(), file.data.size()), compress.settings);
+		    auto     found = last.find(files[i]);
+		    if((found != last.end()) && (found->second == hash) && (!gzip || std::filesystem::exists(file_dir + ".gz", error_code)) &&
+		       (!brotli || std::filesystem::exists(file_dir + ".br", error_code)))
+		    {
+			    hashes[i] = hash;
+			    return true;
+		    }
+
+		    for(const char* extension : {".gz", ".br"})
+		    {
+			    bool        gz          = (extension[1] == 'g');
+			    std::string output_dir  = file_dir + extension;
+			    std::string temp_dir    = output_dir + ".tmp";
+			    if(!((gz) ? (gzip) : (brotli)))
+			    {
+				    std::filesystem::remove(output_dir, error_code);
+				    continue;
+			    }
+			    bool written = (gz) ? (WriteGzipFile(temp_dir, file.data, compress.gzip_level)) : (WriteBrotliFile(temp_dir, file.data, compress.brotli_level));
+			    if(written)
+				    std::filesystem::rename(temp_dir, output_dir, error_code);
+			    if(!written || (error_code != std::error_code()))
+			    {
+				    log_failure(output_dir << " file was NOT written");
+				    std::filesystem::remove(temp_dir, error_code);
+				    return false;
+			    }
+			    site->stats.bytes += std::filesystem::file_size(output_dir, error_code);
+		    }
+		    ++site->stats.compressed;
+		    hashes[i] = hash;
+		    return true;
+	    },
+	    compressed);
+
+	std::vector<std::pair<std::string, uint64_t>> list;
+	for(std::size_t i = 0; i < files.size(); ++i)
+		if(hashes[i])
+			list.push_back({files[i], hashes[i]});
+	if(!WriteCompressedList(site->compressed_file_dir, list))
+		log_failure(site->compressed_file_dir << " file was NOT written");
+	return result;
+}
+
+/* build sites and put final content in their output folders, pages of all sites
+ are generated by the same threads and everything sites are made from stays in given builds,
+ built tells which sites were built successfully */
+bool BuildSites(const std::vector<Site*>& sites, std::vector<SiteBuild>& builds, std::vector<char>& built)
+{
+	ProfileScope scope("BuildSites");
+
+	std::size_t count = sites.size();
+	builds.resize(count);
+	built.assign(count, false);
+
+	// inputs are read one site after another as they add symbols shared by all sites
+	InputCache        cache;
+	std::vector<char> loaded(count, false);
+	for(std::size_t i = 0; i < count; ++i)
+		loaded[i] = PrepareBuild(sites[i], builds[i]) && LoadSiteInputs(sites[i], builds[i], cache);
+
+	// every site is scanned and its files are copied on its own thread
+	std::vector<Manifest>          nexts(count);
+	std::vector<std::vector<Page>> pages(count);
+	std::vector<char>              collected;
+	RunParallelLogged(
+	    count, [&](std::size_t i) -> bool {
+		    if(count > 1)
+			    log_line("########## " << sites[i]->name << " ##########");
+		    return loaded[i] && CollectPages(sites[i], builds[i], nexts[i], pages[i]);
+	    },
+	    collected);
+
+	// pages of all sites are generated together, firsts has an index of the first page of every site
+	std::vector<std::size_t> firsts(count + 1, 0);
+	for(std::size_t i = 0; i < count; ++i)
+		firsts[i + 1] = firsts[i] + pages[i].size();
+	std::vector<char> generated;
+	RunParallelLogged(
+	    firsts[count], [&](std::size_t index) -> bool {
+		    std::size_t i    = (std::size_t)(std::upper_bound(firsts.begin(), firsts.end(), index) - firsts.begin()) - 1;
+		    const Page& page = pages[i][index - firsts[i]];
+		    if(GenerateHTMLFile(builds[i], page, sites[i]))
+			    return true;
+		    log_failure("File: " << page.output_dir << " was NOT generated");
+		    return false;
+	    },
+	    generated);
+
+	bool result = true;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		if(collected[i])
+		{
+			const char* site_generated = generated.data() + firsts[i];
+			FinishBuild(sites[i], builds[i], nexts[i], pages[i], site_generated);
+			built[i] = (std::find(site_generated, site_generated + pages[i].size(), false) == site_generated + pages[i].size());
+		}
+		if(built[i] && (GetValue(sites[i]->config, SYMBOL_COMPRESS_ON_BUILD) == "true"))
+			built[i] = CompressSite(sites[i]);
+		if(built[i])
+			log_success(sites[i]->name << " was built successfully");
+		else
+			log_failure(sites[i]->name << " was NOT built successfully");
+		result = result && built[i];
+	}
+	return result;
+}
+
+/* build a site and put final content in its output folder,
+ everything the site is made from stays in given build */
+bool BuildSite(Site* site, SiteBuild& build)
+{
+	std::vector<SiteBuild> builds;
+	std::vector<char>      built;
+	bool                   result = BuildSites({site}, builds, built);
+	build                         = std::move(builds[0]);
+	return result;
+}
+
+/* build sites into the archive given by --archive instead of their output folders,
+ every site is a folder in it with the name of its output folder */
+bool ArchiveSites(const std::vector<Site*>& sites, std::vector<char>& archived)
+{
+	ProfileScope scope("ArchiveSites");
+
+	archived.assign(sites.size(), false);
+	Archive archive;
+	if(!OpenArchive(archive, options.archive))
+	{
+		log_failure("Archive: " << options.archive << " is NOT open");
+		return false;
+	}
+
+	// sites are added one after another, pages of each are rendered in parallel
+	InputCache cache;
+	for(std::size_t i = 0; i < sites.size(); ++i)
+	{
+		Site*     site = sites[i];
+		SiteBuild build;
+		if(!CheckForDirsAndFiles(site))
+			log_failure("Some needed directories and files are NOT valid");
+		else
+			archived[i] = LoadSiteInputs(site, build, cache) && ArchiveSite(site, build, archive);
+		if(archived[i])
+			log_success(site->name << " was archived successfully");
+		else
+			log_failure(site->name << " was NOT archived successfully");
+	}
+
+	if(!CloseArchive(archive))
+	{
+		log_failure("Archive: " << options.archive << " was NOT written");
+		archived.assign(sites.size(), false);
+		return false;
+	}
+	return std::find(archived.begin(), archived.end(), false) == archived.end();
+}
+
+/* build a site and then keep it up to date after every change in its files,
+ only pages affected by a change are generated again */
+static bool WatchSite(Site* site)
+{
+#ifdef __linux__
+	SiteBuild  build;
+	InputCache cache;
+	bool       loaded = BuildSite(site, build) || build.base;
+	if(!loaded)
+		log_failure(site->name << " was NOT built, waiting for changes");
+
+	int fd = inotify_init1(IN_CLOEXEC);
+	if(fd < 0)
+	{
+		log_failure("Watching files is NOT possible");
+		return false;
+	}
+
+	// site directory for _base.html, _data.txt and _config.txt and every directory in _feed folder
+	constexpr uint32_t events  = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+	int                site_wd = inotify_add_watch(fd, site->directory.c_str(), events);
+	if(site_wd < 0)
+	{
+		log_failure(site->directory << " directory can NOT be watched");
+		close(fd);
+		return false;
+	}
+	std::unordered_map<int, std::string> watched; // directories relative to _feed folder
+	int                                  partials_wd = -1;
+	auto                                 watch_feed  = [&]() {
+		partials_wd = inotify_add_watch(fd, (site->directory + PATH_SEPARATOR + "_partials").c_str(), events);
+		for(const SiteNode& node : build.tree.nodes)
+		{
+			if(!node.is_dir)
+				continue;
+			std::string dir = (node.rel_dir.size()) ? (site->feed_dir + PATH_SEPARATOR + node.rel_dir) : (site->feed_dir);
+			int         wd  = inotify_add_watch(fd, dir.c_str(), events);
+			if(wd >= 0)
+				watched[wd] = node.rel_dir;
+		}
+	};
+	watch_feed();
+	log_success("Watching " << site->name << ", press Ctrl+C to stop");
+	std::cout.flush();
+
+	alignas(inotify_event) char buffer[1 << 16];
+	while(true)
+	{
+		bool                     reload = !loaded, rescan = false;
+		std::vector<std::string> changed;
+
+		// wait for the first change and then collect all that come shortly after it
+		pollfd poll_fd = {fd, POLLIN, 0};
+		int    timeout = -1;
+		while(poll(&poll_fd, 1, timeout) > 0)
+		{
+			ssize_t size = read(fd, buffer, sizeof(buffer));
+			if(size <= 0)
+				break;
+			for(ssize_t offset = 0; offset < size;)
+			{
+				const inotify_event* event = (const inotify_event*)(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				std::string name = (event->len) ? (event->name) : ("");
+				if(event->wd == site_wd)
+				{
+					if((name == "_base.html") || (name == "_data.txt") || (name == "_config.txt"))
+						reload = true;
+					else if((name == "_feed") || (name == "_partials"))
+						rescan = true;
+					continue;
+				}
+
+				// which pages include a file is known only after _feed folder is scanned
+				if(event->wd == partials_wd)
+				{
+					rescan = true;
+					continue;
+				}
+
+				auto found = watched.find(event->wd);
+				if(found == watched.end())
+					continue;
+				if(event->mask & IN_IGNORED)
+				{
+					watched.erase(found);
+					continue;
+				}
+				std::string rel_dir = (found->second.size()) ? (found->second + PATH_SEPARATOR + name) : (name);
+
+				// editors often save a file by moving a new one in its place
+				bool known_file = !(event->mask & IN_ISDIR) && build.tree.paths.count(rel_dir);
+				if(known_file && build.partials->files.count(site->feed_dir + PATH_SEPARATOR + rel_dir))
+					rescan = true;
+				else if((event->mask & IN_CLOSE_WRITE) || ((event->mask & (IN_CREATE | IN_MOVED_TO)) && known_file))
+					changed.push_back(rel_dir);
+				else
+					rescan = true;
+			}
+			timeout = WATCH_DELAY_MS;
+		}
+		if(!reload && !rescan && !changed.size())
+			continue;
+
+		auto start  = std::chrono::steady_clock::now();
+		bool result = true;
+		if(reload)
+			result = loaded = LoadSiteInputs(site, build, cache);
+		if(result && !reload && !rescan)
+		{
+			std::sort(changed.begin(), changed.end());
+			changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+			ReadCompressedList(site->compressed_file_dir, site->compressed);
+			for(const std::string& rel_dir : changed)
+			{
+				if(!UpdateFeedFile(site, build, rel_dir, result))
+				{
+					rescan = true;
+					break;
+				}
+			}
+			WriteDroppedCompressed(site);
+			if(!rescan && !WriteManifest(site->manifest_file_dir, build.manifest))
+				log_failure(site->manifest_file_dir << " manifest file was NOT written");
+		}
+		if(loaded && (reload || rescan))
+		{
+			result = UpdateSite(site, build);
+			watch_feed();
+		}
+
+		auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		if(result)
+			log_success(site->name << " was updated in " << time << " ms");
+		else
+			log_failure(site->name << " was NOT updated successfully");
+		std::cout.flush();
+	}
+#else
+	log_failure("Watching files is possible only on Linux");
+	return false;
+#endif
+}
+
+/* serve a site on 127.0.0.1 without writing its final folder: pages are rendered when they are asked for
+ and kept in memory until their files change, other files are sent straight from _feed folder */
+static bool ServeSite(Site* site)
+{
+#ifdef __linux__
+	if(!CheckForDirsAndFiles(site))
+	{
+		log_failure("Some needed directories and files are NOT valid");
+		return false;
+	}
+
+	int         on      = 1;
+	int         server  = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_in address = {};
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons((uint16_t)options.port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if((server < 0) || (setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0) ||
+	   (bind(server, (const sockaddr*)&address, sizeof(address)) != 0) || (listen(server, SOMAXCONN) != 0))
+	{
+		log_failure("Port " << options.port << " can NOT be used");
+		if(server >= 0)
+			close(server);
+		return false;
+	}
+
+	// the site is held shared while a request is answered and exclusively while it changes
+	SiteBuild                                                           build;
+	InputCache                                                          cache;
+	std::shared_mutex                                                   mutex;
+	std::mutex                                                          pages_mutex;
+	std::unordered_map<std::string, std::shared_ptr<const std::string>> pages;         // rendered pages by their paths
+	std::unordered_map<std::string, unsigned>                           fingerprinted; // nodes by their fingerprinted paths
+	std::mutex                                                          log_mutex;
+	std::string                                                         url = "http://127.0.0.1:" + std::to_string(options.port);
+
+	// links in pages lead to this server instead of url in _data.txt
+	auto load = [&]() {
+		if(!LoadSiteInputs(site, build, cache))
+			return false;
+		site->data.values.resize(std::max<std::size_t>(site->data.values.size(), SYMBOL_URL + 1));
+		site->data.values[SYMBOL_URL] = url;
+		return true;
+	};
+	auto scan = [&]() {
+		ScanSite(site, build);
+		pages.clear();
+		fingerprinted.clear();
+		for(unsigned index = 1; index < build.tree.nodes.size(); ++index)
+		{
+			const SiteNode& node = build.tree.nodes[index];
+			if(node.fingerprint.size())
+				fingerprinted[(std::filesystem::path(node.rel_dir).parent_path() / node.fingerprint).string()] = index;
+		}
+	};
+	bool loaded = load();
+	if(loaded)
+		scan();
+	else
+		log_failure(site->name << " was NOT loaded, waiting for changes");
+
+	auto send_all = [](int client, std::string_view data, int flags) {
+		while(data.size())
+		{
+			ssize_t sent = send(client, data.data(), data.size(), MSG_NOSIGNAL | flags);
+			if(sent <= 0)
+				return false;
+			data.remove_prefix((std::size_t)sent);
+		}
+		return true;
+	};
+
+	// answer a single request, return false if the connection is closed
+	auto answer_request = [&](int client, const std::string& head) {
+		std::istringstream stream(head);
+		std::string        method, target, version;
+		stream >> method >> target >> version;
+		bool keep_alive = (version == "HTTP/1.1") && (head.find("onnection: close") == std::string::npos);
+		bool head_only  = (method == "HEAD");
+
+		std::string                        status = "200 OK", location, path, rel_dir;
+		const char*                        type   = "text/plain; charset=utf-8";
+		std::shared_ptr<const std::string> text; // the body from memory
+		int                                file = -1; // or from a file
+		std::size_t                        size = 0;
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto                                found = build.tree.paths.end();
+			if((method != "GET") && !head_only)
+				status = "405 Method Not Allowed";
+			else if(!loaded)
+				status = "503 Service Unavailable";
+			else if(!DecodeURL(std::string_view(target).substr(0, target.find_first_of("?#")), path) || (path.substr(0, 1) != "/") || !JoinURLPath("", path, rel_dir))
+				status = "400 Bad Request";
+			else
+			{
+				// a directory is its index.html, a URL of a directory always ends with '/' so relative links work
+				found = build.tree.paths.find(rel_dir);
+				if((found != build.tree.paths.end()) && build.tree.nodes[found->second].is_dir)
+				{
+					if(path.back() != '/')
+					{
+						status   = "301 Moved Permanently";
+						location = path + "/";
+					}
+					rel_dir = (rel_dir.size()) ? (rel_dir + PATH_SEPARATOR + "index.html") : ("index.html");
+					found   = build.tree.paths.find(rel_dir);
+				}
+				if(found == build.tree.paths.end())
+				{
+					auto fingerprint = fingerprinted.find(rel_dir);
+					if(fingerprint != fingerprinted.end())
+						found = build.tree.paths.find(build.tree.nodes[fingerprint->second].rel_dir);
+				}
+				type = GetContentType(std::filesystem::path(rel_dir).extension().string());
+			}
+
+			bool answered = location.size() || (status != "200 OK");
+			if(!answered && (found != build.tree.paths.end()))
+			{
+				const SiteNode& node = build.tree.nodes[found->second];
+				if(node.is_html)
+				{
+					{
+						std::lock_guard<std::mutex> pages_lock(pages_mutex);
+						auto                        page = pages.find(node.rel_dir);
+						if(page != pages.end())
+							text = page->second;
+					}
+					if(!text)
+					{
+						auto rendered = std::make_shared<std::string>();
+						Page page     = {site->output_dir + PATH_SEPARATOR + node.rel_dir, site->feed_dir + PATH_SEPARATOR + node.rel_dir, node.rel_dir, node.parent, rendered.get()};
+						if(GenerateHTMLFile(build, page, site))
+						{
+							std::lock_guard<std::mutex> pages_lock(pages_mutex);
+							text = pages[node.rel_dir] = std::move(rendered);
+						}
+						else
+							status = "500 Internal Server Error";
+					}
+				}
+				else if(node.is_rewritten)
+					text = std::make_shared<std::string>(node.rewritten);
+				else
+				{
+					struct stat file_stat;
+					file = open((site->feed_dir + PATH_SEPARATOR + node.rel_dir).c_str(), O_RDONLY | O_CLOEXEC);
+					if((file >= 0) && (fstat(file, &file_stat) == 0))
+						size = (std::size_t)file_stat.st_size;
+					else
+						status = "404 Not Found";
+				}
+			}
+			else if(!answered)
+			{
+				auto nav_file = std::find_if(build.tree.nav_files.begin(), build.tree.nav_files.end(), [&](const NavFile& nav) { return nav.name == rel_dir; });
+				if(nav_file != build.tree.nav_files.end())
+					text = std::make_shared<std::string>(nav_file->text);
+				else
+					status = "404 Not Found";
+			}
+		}
+		if(status != "200 OK")
+		{
+			type = "text/plain; charset=utf-8";
+			text = std::make_shared<std::string>(status + "\n");
+		}
+		if(text)
+			size = text->size();
+
+		std::string header = "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " + std::to_string(size) +
+		                     "\r\nCache-Control: no-cache\r\n" + ((location.size()) ? ("Location: " + location + "\r\n") : ("")) +
+		                     "Connection: " + ((keep_alive) ? ("keep-alive") : ("close")) + "\r\n\r\n";
+		bool sent = send_all(client, header, (head_only) ? (0) : (MSG_MORE));
+		if(sent && !head_only && text)
+			sent = send_all(client, *text, 0);
+		else if(sent && !head_only && (file >= 0))
+		{
+			off_t offset = 0;
+			while(sent && ((std::size_t)offset < size))
+				sent = (sendfile(client, file, &offset, size - (std::size_t)offset) > 0);
+		}
+		if(file >= 0)
+			close(file);
+		log_verbose(method << " " << target << " " << status);
+		return sent && keep_alive;
+	};
+
+	// every connection has its own thread and its requests are answered one after another
+	auto answer = [&](int client) {
+		std::ostringstream log;
+		log_stream      = &log;
+		timeval timeout = {SERVE_TIMEOUT_S, 0};
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		std::string request;
+		char        buffer[1 << 12];
+		bool        open = true;
+		while(open)
+		{
+			std::size_t end = 0;
+			while(open && ((end = request.find("\r\n\r\n")) == std::string::npos))
+			{
+				ssize_t size = recv(client, buffer, sizeof(buffer), 0);
+				open         = (size > 0) && (request.size() < (1 << 16));
+				if(open)
+					request.append(buffer, (std::size_t)size);
+			}
+			if(!open)
+				break;
+			std::string head = request.substr(0, end);
+			request.erase(0, end + 4);
+			open = answer_request(client, head);
+
+			std::lock_guard<std::mutex> lock(log_mutex);
+			std::cout << log.str();
+			std::cout.flush();
+			log.str("");
+		}
+		close(client);
+	};
+
+	int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if(fd < 0)
+	{
+		log_failure("Watching files is NOT possible");
+		close(server);
+		return false;
+	}
+
+	// site directory for _base.html, _data.txt and _config.txt and every directory in _feed folder
+	constexpr uint32_t                   events      = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+	int                                  site_wd     = inotify_add_watch(fd, site->directory.c_str(), events);
+	int                                  partials_wd = -1;
+	std::unordered_map<int, std::string> watched; // directories relative to _feed folder
+	auto                                 watch_feed = [&]() {
+		partials_wd = inotify_add_watch(fd, (site->directory + PATH_SEPARATOR + "_partials").c_str(), events);
+		for(const SiteNode& node : build.tree.nodes)
+		{
+			if(!node.is_dir)
+				continue;
+			std::string dir = (node.rel_dir.size()) ? (site->feed_dir + PATH_SEPARATOR + node.rel_dir) : (site->feed_dir);
+			int         wd  = inotify_add_watch(fd, dir.c_str(), events);
+			if(wd >= 0)
+				watched[wd] = node.rel_dir;
+		}
+	};
+	watch_feed();
+	{
+		std::lock_guard<std::mutex> lock(log_mutex);
+		log_success("Serving " << site->name << " on " << url << ", press Ctrl+C to stop");
+		std::cout.flush();
+	}
+
+	// connections use locals of this function, so their threads are joined before it returns,
+	// finished ones whenever a new connection comes
+	struct Connection
+	{
+		std::thread       thread;
+		std::atomic<bool> done{false};
+	};
+	std::list<Connection> connections;
+
+	alignas(inotify_event) char buffer[1 << 16];
+	pollfd                      poll_fds[2] = {{server, POLLIN, 0}, {fd, POLLIN, 0}};
+	while(true)
+	{
+		if(poll(poll_fds, 2, -1) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+		if(poll_fds[0].revents & POLLIN)
+		{
+			connections.remove_if([](Connection& connection) {
+				if(!connection.done)
+					return false;
+				connection.thread.join();
+				return true;
+			});
+			int client = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+			if(client >= 0)
+			{
+				Connection& connection = connections.emplace_back();
+				connection.thread      = std::thread([&answer, &connection, client]() {
+					answer(client);
+					connection.done = true;
+				});
+			}
+		}
+		if(!(poll_fds[1].revents & POLLIN))
+			continue;
+
+		// changes that come shortly after each other are taken together,
+		// a changed content file drops only its page, anything else scans _feed folder again
+		bool                     reload = !loaded, rescan = false;
+		std::vector<std::string> changed;
+		std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_DELAY_MS));
+		ssize_t size = 0;
+		while((size = read(fd, buffer, sizeof(buffer))) > 0)
+		{
+			for(ssize_t offset = 0; offset < size;)
+			{
+				const inotify_event* event = (const inotify_event*)(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				std::string name = (event->len) ? (event->name) : ("");
+				if(event->wd == site_wd)
+				{
+					if((name == "_base.html") || (name == "_data.txt") || (name == "_config.txt"))
+						reload = true;
+					else if((name == "_feed") || (name == "_partials"))
+						rescan = true;
+					continue;
+				}
+				auto found = watched.find(event->wd);
+				if((event->wd == partials_wd) || (found == watched.end()))
+				{
+					rescan = rescan || (event->wd == partials_wd);
+					continue;
+				}
+				if(event->mask & IN_IGNORED)
+				{
+					watched.erase(found);
+					continue;
+				}
+				std::string rel_dir = (found->second.size()) ? (found->second + PATH_SEPARATOR + name) : (name);
+				auto        node    = build.tree.paths.find(rel_dir);
+				bool        known   = !(event->mask & IN_ISDIR) && (node != build.tree.paths.end()) && !build.tree.nodes[node->second].fingerprint.size();
+				if(known)
+				{
+					// pages are rendered on other threads while their included files are read
+					std::shared_lock<std::shared_mutex> partials_lock(build.partials->mutex);
+					known = !build.partials->files.count(site->feed_dir + PATH_SEPARATOR + rel_dir);
+				}
+				if(known && (event->mask & (IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO)))
+					changed.push_back(rel_dir);
+				else
+					rescan = true;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		if(reload)
+			loaded = load();
+		if(loaded && (reload || rescan))
+		{
+			scan();
+			watch_feed();
+		}
+		for(const std::string& rel_dir : changed)
+			pages.erase(rel_dir);
+
+		std::lock_guard<std::mutex> log_lock(log_mutex);
+		if(loaded)
+			log_success(site->name << " was updated");
+		else
+			log_failure(site->name << " was NOT loaded");
+		std::cout.flush();
+	}
+
+	// an idle connection ends when its read times out
+	for(Connection& connection : connections)
+		connection.thread.join();
+	close(fd);
+	close(server);
+	return false;
+#else
+	log_failure("Serving a site is possible only on Linux");
+	return false;
+#endif
+}
+
+/* delete final site output folder */
+static bool CleanSite(Site* site)
+{
+	std::filesystem::remove(site->manifest_file_dir, error_code);
+	log_error_code;
+	std::filesystem::remove_all(site->output_dir, error_code);
+	log_error_code;
+	if(!std::filesystem::create_directory(site->output_dir, error_code))
+	{
+		log_error_code;
+		return false;
+	}
+	return true;
+}
+
+/* print some information about a site */
+bool InfoSite(Site* site)
+{
+	if(!CheckForDirsAndFiles(site))
+	{
+		log_failure("Some needed directories and files are NOT valid");
+		return false;
+	}
+
+	log_line("\n########## Info from _feed folder ##########");
+	unsigned long long num_folders = 0, num_HTML_files = 0, num_other_files = 0;
+	for(const auto& entry : std::filesystem::recursive_directory_iterator(site->feed_dir, error_code))
+	{
+		log_error_code;
+		std::string name = entry.path().filename().string();
+		if(entry.is_directory(error_code)) ++num_folders;
+		else if(entry.is_regular_file(error_code))
+		{
+			if(entry.path().extension().string() == ".html")
+				++num_HTML_files;
+			else
+				++num_other_files;
+		}
+	}
+	log_line("Number of folders: " << num_folders);
+	log_line("Number of HTML files: " << num_HTML_files);
+	log_line("Number of other files: " << num_other_files);
+	log_line("############################################\n");
+
+	log_line("\n########## Info from _data file ##########");
+	if(!ReadDataFile(site->data_file_dir, *site->symbols, site->data))
+	{
+		log_failure(site->name << " site data file was NOT read");
+		return false;
+	}
+	for(unsigned symbol : site->data.keys)
+		log_line("### Key: " << site->symbols->names[symbol] << " ### Value: " << site->data.values[symbol]);
+	log_line("############################################\n");
+
+	log_line("\n########## Info from _cofig file ##########");
+	if(!ReadDataFile(site->config_file_dir, *site->symbols, site->config))
+	{
+		log_failure(site->name << " site config file was NOT read");
+		return false;
+	}
+	for(unsigned symbol : site->config.keys)
+		log_line("### Key: " << site->symbols->names[symbol] << " ### Value: " << site->config.values[symbol]);
+	log_line("############################################\n");
+
+	return true;
+}
+
+/* delete a whole site folder */
+static bool DeleteSite(Site* site)
+{
+	uintmax_t num = 0;
+	num           = std::filesystem::remove_all(site->directory, error_code);
+	log_error_code;
+	if(!num)
+	{
+		log_failure("Nothing was removed");
+		return false;
+	}
+	log_success("Removed " << num << " files or directories");
+	return true;
+}
+
+/* reduce sizes of files in final site folder */
+bool PackSite(Site* site)
+{
+	ProfileScope scope("PackSite");
+
+	if(!ReadDataFile(site->config_file_dir, *site->symbols, site->config))
+	{
+		log_failure(site->name << " site config file was NOT read");
+		return false;
+	}
+
+	if(std::filesystem::is_directory(site->output_dir, error_code))
+	{
+		auto CheckIfContains = [=](std::vector<std::string> vec, std::string val) -> bool {
+			for(std::string str : vec)
+				if(str == val)
+					return true;
+			return false;
+		};
+
+		// pages are already packed when they were generated with pack_on_build
+		bool pack_on_build = (GetValue(site->config, SYMBOL_PACK_ON_BUILD) == "true");
+
+		// find all files to pack first so they can be packed in parallel
+		std::vector<std::string> files;
+		std::vector<std::string> vec = SplitString(GetValue(site->config, SYMBOL_TO_PACK), ',');
+		for(const auto& entry : std::filesystem::recursive_directory_iterator(site->output_dir, error_code))
+		{
+			log_error_code;
+
+			if(entry.is_regular_file(error_code))
+			{
+				std::string extension = entry.path().extension().string();
+				if(CheckIfContains(vec, extension) && !(pack_on_build && (extension == ".html")))
+					files.push_back(entry.path().string());
+				else
+					log_verbose("Omitted file in packing: " << entry.path().filename().string());
+			}
+		}
+		std::sort(files.begin(), files.end());
+
+		std::vector<char> packed;
+		if(!RunParallelLogged(
+		       files.size(), [&](std::size_t i) { return PackFile(files[i], site->stats); }, packed))
+			return false;
+	}
+	else
+	{
+		log_failure(site->output_dir << " directory with the site output was NOT found");
+		return false;
+	}
+
+	return true;
+}
+
+/* do a site task other than build for a single site and log how it went */
+bool DoSiteTask(const std::string& task, Site* site)
+{
+	bool result = false;
+	if(task == "new")
+	{
+		result = NewSite(site);
+		if(result)
+			log_success(site->name << " has been created properly");
+		else
+			log_failure(site->name << "has NOT been created properly");
+	}
+	else if(task == "watch")
+	{
+		result = WatchSite(site);
+		if(!result)
+			log_failure(site->name << " was NOT watched");
+	}
+	else if(task == "serve")
+	{
+		result = ServeSite(site);
+		if(!result)
+			log_failure(site->name << " was NOT served");
+	}
+	else if(task == "clean")
+	{
+		result = CleanSite(site);
+		if(result)
+			log_success("Cleaning " << site->name << " was completed");
+		else
+			log_failure("Cleaning " << site->name << " was NOT completed");
+	}
+	else if(task == "info")
+	{
+		result = InfoSite(site);
+		if(!result)
+			log_failure("All information about '" << site->name << "' was NOT given");
+	}
+	else if(task == "delete")
+	{
+		result = DeleteSite(site);
+		if(result)
+			log_success(site->name << " was deleted successfully");
+		else
+			log_failure(site->name << " was NOT deleted successfully");
+	}
+	else if(task == "pack")
+	{
+		result = PackSite(site) && CompressSite(site);
+		if(result)
+			log_success(site->name << " was packed successfully");
+		else
+			log_failure(site->name << " was NOT packed successfully");
+	}
+	return result;
+}
+
+// > SITE-TASKS
+/////////////////////////////////////////////////////
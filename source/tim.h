@@ -0,0 +1,583 @@
+// ==================================================
+// file: tim.h
+// project: Tim Site Generator
+// author: Paulina Kalicka
+// ==================================================
+
+#pragma once
+
+constexpr const char* TIM_VERSION = "v1.0";
+constexpr const char* TIM_NAME    = "Tim Site Generator";
+constexpr const char* TIM_AUTHOR  = "Paulina Kalicka";
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+#ifdef TIM_WITH_ZLIB
+	#include <zlib.h>
+#endif
+
+#ifdef TIM_WITH_BROTLI
+	#include <brotli/encode.h>
+#endif
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <linux/fs.h>
+	#include <linux/io_uring.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <sys/ioctl.h>
+	#include <sys/mman.h>
+	#include <sys/sendfile.h>
+	#include <sys/socket.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+extern thread_local std::error_code error_code; // error code from filesystem, every thread has its own
+
+// where messages are logged, a page generated on a worker thread logs into its own buffer,
+// stderr when stdout is used for an archive
+extern std::ostream*              log_output;
+extern thread_local std::ostream* log_stream;
+
+/* how much is logged, messages above the level are not even formatted */
+enum class LogLevel
+{
+	QUIET,   // only failures, errors and reports asked for
+	NORMAL,  // also progress of tasks
+	VERBOSE, // also a message for every file
+};
+
+extern LogLevel log_level;
+
+// waits for a key so a console opened by double-click stays open, never in batch mode
+#define wait ((options.batch) ? ((void)0) : ((void)std::cin.get(), (void)std::cin.get()))
+
+#define log_enabled(level) (log_level >= (level))
+#define log_word(x)        (log_enabled(LogLevel::NORMAL) ? ((void)(*log_stream << x)) : ((void)0))
+#define log_line(x)        (log_enabled(LogLevel::NORMAL) ? ((void)(*log_stream << x << "\n")) : ((void)0))
+#define log_verbose(x)     (log_enabled(LogLevel::VERBOSE) ? ((void)(*log_stream << x << "\n")) : ((void)0))
+#define log_report(x)      (*log_stream << x << "\n")
+#define log_success(x)     (log_enabled(LogLevel::NORMAL) ? ((void)(*log_stream << "++++++++++ " << x << " ++++++++++\n")) : ((void)0))
+#define log_failure(x)     (*log_stream << "---------- " << x << " ----------\n")
+#define log_error_code                  \
+	if(error_code != std::error_code()) \
+	*log_stream << "Error code: " << error_code << " " << error_code.message() << "\n"
+
+#define COMMAND_STRUCTURE   ("tim [site_name] [site_task]   /   tim [site_task] [site_name...]   /   tim [app_task]")
+#define POSSIBLE_SITE_TASKS ("new / build / watch / serve / clean / info / delete / pack")
+#define POSSIBLE_APP_TASKS  ("help / v / todo")
+#define POSSIBLE_OPTIONS    ("-j [number_of_threads / auto] / --full / --profile[=trace_file] / --batch / --quiet / --verbose / --cache[=cache_dir] / --sync / --port=number / --archive=file / --io-uring")
+
+// separator of directories in paths built by hand
+#ifdef _WIN32
+	#define PATH_SEPARATOR "\\"
+#else
+	#define PATH_SEPARATOR "/"
+#endif
+
+#define EXAMPLE_FOLDER "data" PATH_SEPARATOR "example"
+
+#define WATCH_DELAY_MS       10        // how long to wait for more changes before building
+#define SERVE_TIMEOUT_S      5         // how long serve task keeps an idle connection
+#define PACK_CHUNK_SIZE      (1 << 16) // how many bytes are packed at once
+#define PAGE_FLUSH_SIZE      (1 << 20) // how many bytes of a page are written to its file at once
+#define PAGE_BUFFER_LIMIT    (1 << 24) // the biggest buffer for pages kept by a thread
+#define ARCHIVE_BATCH_SIZE   256       // how many files are rendered before they are added to an archive
+#define IO_RING_DEPTH        64        // how many files are open or read at once with --io-uring
+#define IO_RING_FILE_LIMIT   (1 << 20) // the biggest file read with --io-uring, bigger ones are mapped
+#define PROFILE_TOP_PAGES    10        // how many of the slowest pages are shown by --profile
+#define RENDER_CACHE_VERSION 3         // changed whenever keys of the render cache mean something else
+#define MANIFEST_VERSION     "3"       // changed whenever entries of the manifest mean something else
+
+/* options given in the command line next to a task */
+struct Options
+{
+	unsigned    jobs    = 0;      // number of threads generating pages, 0 means one per core
+	bool        full    = false;  // build everything again instead of only what has changed
+	bool        profile = false;  // measure phases and pages and print a summary at the end
+	std::string trace_file_dir;   // where a trace of measured events is written, none if empty
+	bool        batch = false;    // never ask for anything or wait for a key
+	std::string cache_dir;        // render cache of all sites, none if empty and not in _config.txt
+	bool        sync = false;     // write only files whose bytes have changed and remove files that are not built
+	unsigned    port = 8080;      // port of serve task on 127.0.0.1
+	std::string archive;          // tar, tar.gz or zip file a build is written into instead of output folders, '-' for stdout
+	bool        io_uring = false; // read content files with io_uring on Linux, many of them at once
+};
+
+extern Options options;
+
+// site tasks, a task given before names of sites can be done for many sites at once
+constexpr const char* SITE_TASKS[] = {"new", "build", "watch", "serve", "clean", "info", "delete", "pack"};
+
+/* work done by a task for a site, printed in its summary */
+struct Stats
+{
+	std::atomic<uint64_t> pages{0};      // pages generated
+	std::atomic<uint64_t> cached{0};     // pages taken from the render cache instead
+	std::atomic<uint64_t> assets{0};     // files copied from _feed folder
+	std::atomic<uint64_t> packed{0};     // files packed
+	std::atomic<uint64_t> compressed{0}; // files compressed to .gz or .br files next to them
+	std::atomic<uint64_t> unchanged{0};  // pages and files with --sync that were the same as in the output folder
+	std::atomic<uint64_t> bytes{0};      // bytes of generated pages, copied, packed and compressed files
+};
+
+constexpr unsigned NO_SYMBOL = ~0u;
+
+/* names of keys interned once, every name gets a number
+ used to find its value without hashing the name again */
+struct SymbolTable
+{
+	std::unordered_map<std::string, unsigned> ids;
+	std::vector<std::string>                  names;
+};
+
+// symbols known before any file is read, interned in this order
+enum Symbol : unsigned
+{
+	SYMBOL_URL,
+	SYMBOL_INDEX_PAGE,
+	SYMBOL_TO_PACK,
+	SYMBOL_PACK_ON_BUILD,
+	SYMBOL_COPY_MODE,
+	SYMBOL_CACHE_DIR,
+	SYMBOL_NAV_MODE,
+	SYMBOL_NAV_PAGE_SIZE,
+	SYMBOL_COMPRESS,
+	SYMBOL_COMPRESS_ON_BUILD,
+	SYMBOL_COMPRESS_MIN_SIZE,
+	SYMBOL_GZIP_LEVEL,
+	SYMBOL_BROTLI_LEVEL,
+	SYMBOL_FINGERPRINT,
+	PREDEFINED_SYMBOLS,
+};
+constexpr const char* PREDEFINED_SYMBOL_NAMES[PREDEFINED_SYMBOLS] = {"url", "index_page", "to_pack", "pack_on_build", "copy_mode", "cache_dir", "nav_mode", "nav_page_size",
+                                                                     "compress", "compress_on_build", "compress_min_size", "gzip_level", "brotli_level", "fingerprint"};
+
+/* values of a data file (_data.txt/_config.txt) stored by symbols of their keys */
+struct DataFile
+{
+	std::vector<std::string> values; // by symbol, empty if not defined
+	std::vector<unsigned>    keys;   // symbols in the order they were read
+};
+
+struct Site
+{
+	std::string name;
+
+	std::string directory;
+	std::string base_file_dir;
+	std::string feed_dir;
+	std::string index_file_dir;
+	std::string output_dir;
+	std::string data_file_dir;
+	std::string config_file_dir;
+	std::string manifest_file_dir;
+	std::string compressed_file_dir;   // hashes of files whose .gz and .br files are up to date
+	std::string fingerprints_file_dir; // names of assets with hashes of their content
+	std::string cache_dir;             // render cache, none if empty
+
+	SymbolTable* symbols = nullptr; // shared by all sites built together so they can share templates
+	DataFile     data;
+	DataFile     config;
+	Stats        stats;
+
+	// _compressed.txt as it was when a build has started, files written again by the build are dropped from it
+	std::unordered_map<std::string, uint64_t> compressed;
+	std::mutex                                compressed_mutex;           // pages are written on many threads
+	bool                                      compressed_dropped = false; // so _compressed.txt is written again
+};
+
+/* type of a single instruction in a compiled template */
+enum class TokenType
+{
+	TEXT,            // literal chunk written as it is
+	CONTENT,         // ~_content~
+	NAME,            // ~_name~
+	URL,             // ~_url~
+	THIS_URL,        // ~_this_url~
+	TITLE,           // ~_title~
+	PREV_LINKS,      // ~_prev_links~
+	NEXT_LINKS,      // ~_next_links~
+	FEED_LINKS,      // ~_feed_links~
+	PAGE_LINKS,      // ~_page_links~
+	IF,              // ~_if.args~
+	IFNOT,           // ~_ifnot.args~
+	ENDIF,           // ~_endif~
+	SITE_DATA,       // ~:key~ (from _data.txt)
+	PAGE_DATA,       // ~+key~ (from the beginning of a content file)
+	INCLUDE,         // ~=file~ (relative to the page or in _partials folder)
+	UNDEFINED_DATA,  // ~_key~ with unknown key
+	UNDEFINED_TOKEN, // unknown character after '~'
+};
+
+constexpr std::size_t TOKEN_TYPES = (std::size_t)TokenType::UNDEFINED_TOKEN + 1;
+
+struct Token
+{
+	TokenType type = TokenType::TEXT;
+
+	std::string              text; // name of data to replace or file to include
+	std::vector<std::string> arguments;
+	unsigned                 symbol = NO_SYMBOL; // symbol of data to replace
+	std::string_view         literal;            // literal text, a part of the file the template was compiled from
+};
+
+/* a file with '~' tokens parsed once into a list of instructions */
+struct Template
+{
+	std::vector<Token> tokens;
+	std::string        source;   // the file it was compiled from if the template owns it
+	uint64_t           hash = 0; // hash of the file it was compiled from
+};
+
+/* a single file or directory in _feed folder */
+struct SiteNode
+{
+	std::string name;    // file or directory name
+	std::string rel_dir; // path relative to _feed folder
+	unsigned    parent  = 0;
+	bool        is_dir  = false;
+	bool        is_html = false;
+	uint64_t    stamp   = 0; // hash of size and last write time (files only)
+
+	std::vector<unsigned> children;         // sorted by name (directories only)
+
+	// the same for every page in the directory (directories only)
+	std::string this_url;
+	std::string prev_links;
+	std::string next_links;
+	std::string page_links;
+	uint64_t    nav_hash           = 0; // hash of this_url and prev_links
+	uint64_t    listing_links_hash = 0; // hash of next_links and page_links
+
+	// assets with fingerprint in _config.txt are also copied under a name with a hash of their content
+	std::string fingerprint;      // that name, empty if the file is not fingerprinted
+	uint64_t    content_hash = 0; // hash of the content that is copied
+	std::string rewritten;        // CSS with references to fingerprinted assets rewritten
+	bool        is_rewritten = false;
+};
+
+/* a file with navigation links written once and shared by pages, in _nav folder of a directory */
+struct NavFile
+{
+	std::string name; // path relative to the output folder
+	std::string text;
+};
+
+/* _feed folder scanned once, the first node is _feed folder itself */
+struct SiteTree
+{
+	std::vector<SiteNode>                     nodes;
+	std::unordered_map<std::string, unsigned> paths; // nodes by paths relative to _feed folder
+	std::string                               feed_links;
+	uint64_t                                  feed_links_hash = 0;
+	std::vector<NavFile>                      nav_files;
+
+	// fingerprinted names of assets by their paths relative to the output folder (always with '/')
+	std::unordered_map<std::string, std::string> fingerprints;
+	uint64_t                                     fingerprints_hash = 0; // 0 if no asset is fingerprinted
+};
+
+/* data from the beginning of a content file, keys and values are parts of the file,
+ one is reused for all pages generated on the same thread */
+struct PageData
+{
+	struct Item
+	{
+		unsigned         symbol = NO_SYMBOL; // NO_SYMBOL if the key is not used by _base.html
+		std::string_view key;
+		std::string_view value;
+	};
+	std::vector<Item> items;
+	std::size_t       size = 0; // items of the current page
+};
+
+/* a single final HTML file to generate */
+struct Page
+{
+	std::string  output_dir;         // final file in the output folder
+	std::string  content_dir;        // its content file in _feed folder
+	std::string  name;               // path relative to the output folder
+	unsigned     dir      = 0;       // node of the directory with the page
+	std::string* rendered = nullptr; // with serve task the page is rendered into it instead of its file
+};
+
+// what directory listings a page uses, saved in the manifest
+constexpr uint64_t USES_DIR_LISTING  = 1; // ~_next_links~ or ~_page_links~
+constexpr uint64_t USES_FEED_LISTING = 2; // ~_feed_links~
+constexpr uint64_t USES_INCLUDES     = 4; // ~=file~
+
+// what values of the site and the page templates use, only for keys of the render cache
+constexpr uint64_t USES_NAME       = 8;   // ~_name~
+constexpr uint64_t USES_URL        = 16;  // ~_url~
+constexpr uint64_t USES_TITLE      = 32;  // ~_title~
+constexpr uint64_t USES_NAV        = 64;  // ~_this_url~ or ~_prev_links~
+constexpr uint64_t USES_CONDITIONS = 128; // ~_if.args~ or ~_ifnot.args~
+
+/* state of a single output file or directory after the last build */
+struct ManifestEntry
+{
+	char     type        = 0; // 'd' directory, 'f' copied file, 'p' generated page, 'n' file with navigation links, 'a' fingerprinted copy of a file
+	uint64_t stamp       = 0; // hash of size and last write time of the source
+	uint64_t source_hash = 0; // hash of the source content (pages only)
+	uint64_t flags       = 0; // listings used by the source (pages only)
+	uint64_t key         = 0; // hash of all inputs the output was made from
+};
+
+/* all output files and directories with their paths relative to the output folder */
+using Manifest = std::unordered_map<std::string, ManifestEntry>;
+
+/* a file included with ~=file~ */
+struct Partial
+{
+	bool        found = false; // the file was read
+	std::string dir;           // directory its own includes are relative to
+	Template    tmpl;
+	uint64_t    flags = 0; // listings used by it and files it includes
+	uint64_t    hash  = 0; // hash of it, files it includes and data from _data.txt they use
+};
+
+/* a name of a file to include resolved from a directory */
+struct Include
+{
+	std::string    file_dir;          // next to the file that includes it or in _partials folder
+	const Partial* partial = nullptr; // nullptr until it is read
+};
+
+/* included files of a build by their paths, each is read and compiled once and shared by all pages */
+struct Partials
+{
+	std::shared_mutex                                         mutex; // guards files and includes
+	std::unordered_map<std::string, std::unique_ptr<Partial>> files;
+	std::unordered_map<std::string, Include>                  includes; // by a directory and a name separated by '\n'
+};
+
+/* everything a build is made from, kept in memory between builds while watching */
+struct SiteBuild
+{
+	std::shared_ptr<const Template> base;      // may be shared with other sites that have the same _base.html
+	std::shared_ptr<const Template> page_base; // base with values of the site written in, new for every scan of _feed folder
+	SiteTree                        tree;
+	Manifest                        manifest;
+	uint64_t                        inputs_hash         = 0;                            // hash of _base.html, _data.txt and _config.txt
+	std::shared_ptr<Partials>       partials            = std::make_shared<Partials>(); // new for every scan of _feed folder
+	unsigned                        folded[TOKEN_TYPES] = {};                           // tokens of base written into text of page_base
+};
+
+/* inputs of sites built together by hashes of their files,
+ a file with the same content as one read before is not parsed again */
+struct InputCache
+{
+	std::unordered_map<uint64_t, std::shared_ptr<const Template>> templates;
+	std::unordered_map<uint64_t, DataFile>                        data_files;
+};
+
+/* where in a file a packer is */
+enum class PackState
+{
+	TEXT,     // whitespace is reduced
+	TAG_NAME, // just after '<'
+	RAW_TAG,  // attributes of <pre>, <textarea> or <script>
+	RAW,      // content of <pre>, <textarea> or <script> copied as it is
+	COMMENT,  // HTML comment copied as it is
+};
+
+/* how files of a site are compressed, as given by compress, compress_min_size, gzip_level and brotli_level in _config.txt */
+struct CompressOptions
+{
+	bool     gzip         = false;
+	bool     brotli       = false;
+	unsigned min_size     = 256; // a smaller file is sent faster as it is
+	unsigned gzip_level   = 9;
+	unsigned brotli_level = 11;
+	uint64_t settings     = 0; // hash of formats and levels, a part of hashes in _compressed.txt
+};
+
+/* state of packing a file which is given in chunks */
+struct Packer
+{
+	bool html       = false; // knows about HTML elements and comments
+	bool keep_lines = false; // a run of whitespace with a new line becomes a new line
+
+	PackState   state    = PackState::TEXT;
+	bool        space    = false; // whitespace to write before the next character
+	bool        new_line = false; // that whitespace had a new line
+	std::string tag;              // name of the element being read
+	std::string end_tag;          // closing tag of the element copied as it is
+	std::size_t matched = 0;      // how many characters of the end are already read
+};
+
+/* a whole file to read, memory-mapped if it is possible,
+ so even a file bigger than memory is only paged in as it is read */
+struct MappedFile
+{
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	std::string_view data;           // the whole file
+	bool             mapped = false; // data is mapped, otherwise it is in the buffer
+	std::string      buffer;
+};
+
+/* a file written in chunks */
+struct OutputFile
+{
+#ifdef __linux__
+	int fd = -1;
+#else
+	std::ofstream file;
+#endif
+};
+
+#ifdef __linux__
+/* rings shared with the kernel by io_uring, used through system calls without liburing */
+struct IoRing
+{
+	int           fd        = -1;
+	unsigned      entries   = 0;
+	unsigned      tail      = 0;          // of the submission queue, given to the kernel on submit
+	unsigned*     sq_head   = nullptr;
+	unsigned*     sq_tail   = nullptr;
+	unsigned*     sq_mask   = nullptr;
+	unsigned*     sq_array  = nullptr;
+	io_uring_sqe* sqes      = nullptr;
+	unsigned*     cq_head   = nullptr;
+	unsigned*     cq_tail   = nullptr;
+	unsigned*     cq_mask   = nullptr;
+	io_uring_cqe* cqes      = nullptr;
+	void*         sq_map    = MAP_FAILED;
+	void*         cq_map    = MAP_FAILED; // the same as sq_map if the kernel maps both rings at once
+	void*         sqes_map  = MAP_FAILED;
+	std::size_t   sq_size   = 0;
+	std::size_t   cq_size   = 0;
+	std::size_t   sqes_size = 0;
+};
+#endif
+
+
+/* a file in a zip archive, kept for its central directory */
+struct ZipEntry
+{
+	std::string name;
+	uint32_t    crc             = 0;
+	uint32_t    size            = 0;
+	uint32_t    compressed_size = 0;
+	uint32_t    offset          = 0; // of its local header
+	uint16_t    method          = 0; // 0 stored, 8 deflated
+};
+
+/* an archive a build is streamed into instead of the output folder */
+struct Archive
+{
+	char                  format = 't'; // 't' tar, 'g' tar compressed with gzip, 'z' zip
+	OutputFile            file;
+	bool                  failed   = false;
+	uint64_t              offset   = 0; // bytes written to the file
+	uint64_t              mtime    = 0; // time of all entries, $SOURCE_DATE_EPOCH if it is set
+	uint32_t              dos_time = 0; // the same in MS-DOS format for zip
+	std::vector<ZipEntry> entries;
+	std::string           buffer; // compressed bytes
+#ifdef TIM_WITH_ZLIB
+	z_stream stream = {}; // tar.gz only
+#endif
+};
+
+/* a span of time measured with --profile */
+struct ProfileEvent
+{
+	const char* name;        // phase or function
+	std::string detail;      // file it was about, if any
+	uint64_t    begin    = 0; // nanoseconds since the profile started
+	uint64_t    duration = 0; // nanoseconds
+	unsigned    thread   = 0;
+};
+
+/* everything measured with --profile, shared by all threads */
+struct Profile
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::mutex                mutex; // guards everything below
+	std::vector<ProfileEvent> events;
+	uint64_t                  token_time[TOKEN_TYPES]   = {}; // nanoseconds spent on tokens of every type
+	uint64_t                  token_count[TOKEN_TYPES]  = {};
+	uint64_t                  token_folded[TOKEN_TYPES] = {}; // tokens not evaluated as they were written into _base.html once per build
+};
+
+extern Profile profile;
+
+/* measure time from its creation to the end of its scope when profiling */
+struct ProfileScope
+{
+	ProfileScope(const char* name, const std::string& detail = std::string());
+	~ProfileScope();
+
+	const char*                           name;
+	std::string                           detail;
+	std::chrono::steady_clock::time_point begin;
+};
+
+/////////////////////////////////////////////////////
+// < SHARED FUNCTIONS
+
+// defined in tim.cpp, used by the app in main.cpp and by benchmarks in bench.cpp
+
+void               InitSymbols(SymbolTable& symbols);
+const std::string& GetValue(const DataFile& data_file, unsigned symbol);
+bool               ParseUnsigned(std::string str, unsigned& value);
+bool               WriteFile(std::string file_dir, const std::string& str_data);
+bool               CopyFeedFile(std::string from, std::string to, const std::string& mode);
+void               ReadFiles(const std::vector<std::string>& files, const std::function<void(std::size_t, std::string_view)>& task, std::vector<char>& read);
+void               ReportProfile();
+void               InitDirs(Site* site);
+void               ScanFeed(Site* site, SiteTree& tree);
+void               WriteNavLinks(Site* site, SiteTree& tree);
+bool               ReadDataFile(std::string file_dir, SymbolTable& symbols, DataFile& data_file);
+void               SpecializeBase(Site* site, SiteBuild& build);
+bool               GenerateHTMLFile(const SiteBuild& build, const Page& page, Site* site);
+void               GetDataListingFlags(std::string_view str_data, uint64_t& flags, uint64_t& hash);
+bool               LoadSiteInputs(Site* site, SiteBuild& build, InputCache& cache);
+bool               BuildSites(const std::vector<Site*>& sites, std::vector<SiteBuild>& builds, std::vector<char>& built);
+bool               BuildSite(Site* site, SiteBuild& build);
+bool               ArchiveSites(const std::vector<Site*>& sites, std::vector<char>& archived);
+bool               InfoSite(Site* site);
+bool               PackSite(Site* site);
+bool               DoSiteTask(const std::string& task, Site* site);
+
+// > SHARED FUNCTIONS
+/////////////////////////////////////////////////////